@@ -19,21 +19,28 @@ function cleanup {
       echo "vsim pid exists, killing it"
       kill -- -"${vsim_pgid}"
   fi
-  rm "${vsim_out}"
+  rm -f "${vsim_out}" "${JTAG_UNIX_SOCKET}"
 }
 
 trap cleanup EXIT
 
+# SIMULATOR=veri runs the testbench with verilator instead of vsim
+SIMULATOR=${SIMULATOR:-vsim}
+
 vsim_out=$(mktemp)
 openocd_out=openocd.log
 
-make -C "${ROOT}"/tb/dm vsim-run &> "${vsim_out}"&
+# openocd and the simulation run on the same machine, so skip the tcp loopback
+# and talk over a unix domain socket
+export JTAG_UNIX_SOCKET=$(mktemp -u /tmp/jtag.XXXXXX)
+
+make -C "${ROOT}"/tb/dm "${SIMULATOR}"-run &> "${vsim_out}"&
 # record vsim pid/pgid to kill it if it survives this script
 vsim_pid=$!
 vsim_pgid=$(ps -o pgid= ${vsim_pid} | grep -o [0-9]*)
 
-# block until we get "Listening on port" so that we are safe to connect openocd
-coproc grep -m 1 "Listening on port"
+# block until we get "Listening on" so that we are safe to connect openocd
+coproc grep -m 1 "Listening on"
 tail -f -n0 "${vsim_out}" --pid "$COPROC_PID" >&"${COPROC[1]}"
 
 echo "Starting openocd"
@@ -64,6 +64,9 @@ parameter OPCODE_PULP_OP    = 7'h5b;
 parameter OPCODE_VECOP      = 7'h57;
 parameter OPCODE_HWLOOP     = 7'h7b;
 
+// unused by RV32 (OP-32), free for accelerators on the APU interface
+parameter OPCODE_APU_CUSTOM = 7'h3b;
+
 parameter REGC_S1   = 2'b10;
 parameter REGC_S4   = 2'b00;
 parameter REGC_RD   = 2'b01;
@@ -31,6 +31,7 @@ import riscv_defines::*;
 module riscv_alu
 #(
   parameter SHARED_INT_DIV = 0,
+  parameter FAST_INT_DIV   = 0,
   parameter FPU            = 0
 )(
   input  logic                     clk,
@@ -1003,14 +1004,66 @@ module riscv_alu
       assign div_op_b_signed = operand_b_i[31] & div_signed;
 
       assign div_shift_int = ff_no_one ? 6'd31 : clb_result;
-      assign div_shift = div_shift_int + (div_op_a_signed ? 6'd0 : 6'd1);
+
+      if (FAST_INT_DIV == 1) begin : div_early_term
+
+        // Early termination: the divisor is only shifted up to just above
+        // the most significant bit of the dividend. The skipped steps could
+        // only produce leading zeros in the quotient. One step more than
+        // needed is kept, so the bound also holds for negative operands.
+        logic [31:0] div_op_b_rev;     // dividend, inverted if negative
+        logic [4:0]  div_op_b_ff1;
+        logic        div_op_b_no_one;
+        logic [5:0]  div_lead_a;       // leading zeros/sign bits of the divisor
+        logic [5:0]  div_lead_b;       // leading zeros/sign bits of the dividend
+        logic [5:0]  div_shift_full;
+        logic [6:0]  div_shift_early;
+
+        for (genvar i = 0; i < 32; i++) begin
+          assign div_op_b_rev[i] = div_op_b_signed ? operand_b_neg[31-i] : operand_b_i[31-i];
+        end
+
+        alu_ff div_ff_i
+        (
+          .in_i        ( div_op_b_rev    ),
+          .first_one_o ( div_op_b_ff1    ),
+          .no_ones_o   ( div_op_b_no_one )
+        );
+
+        assign div_lead_a = ff_no_one       ? 6'd32 : {1'b0, ff1_result};
+        assign div_lead_b = div_op_b_no_one ? 6'd32 : {1'b0, div_op_b_ff1};
+
+        assign div_shift_full  = div_shift_int + (div_op_a_signed ? 6'd0 : 6'd1);
+        assign div_shift_early = {1'b0, div_lead_a} + 7'd1 - {1'b0, div_lead_b};
+
+        // division by zero needs all the steps to return all ones
+        always_comb begin
+          if (cnt_result == 0)
+            div_shift = div_shift_full;
+          else if (div_shift_early[6])
+            div_shift = 6'd0;
+          else if (div_shift_early[5:0] < div_shift_full)
+            div_shift = div_shift_early[5:0];
+          else
+            div_shift = div_shift_full;
+        end
+
+      end else begin : div_full
+
+        assign div_shift = div_shift_int + (div_op_a_signed ? 6'd0 : 6'd1);
+
+      end
 
       assign div_valid = enable_i & ((operator_i == ALU_DIV) || (operator_i == ALU_DIVU) ||
                          (operator_i == ALU_REM) || (operator_i == ALU_REMU));
 
 
       // inputs A and B are swapped
-      riscv_alu_div div_i
+      riscv_alu_div
+      #(
+        .C_RADIX4     ( FAST_INT_DIV      )
+        )
+      div_i
         (
          .Clk_CI       ( clk               ),
          .Rst_RBI      ( rst_n             ),
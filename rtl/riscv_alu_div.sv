@@ -15,6 +15,9 @@
 ///////////////////////////////////////////////////////////////////////////////
 //
 // Description: this is a simple serial divider for signed integers (int32).
+//              With C_RADIX4 two quotient bits are computed per cycle by
+//              chaining two compare/subtract steps, which halves the number
+//              of divide cycles.
 //
 ///////////////////////////////////////////////////////////////////////////////
 //
@@ -26,7 +29,8 @@
 module riscv_alu_div
 #(
    parameter C_WIDTH     = 32,
-   parameter C_LOG_WIDTH = 6
+   parameter C_LOG_WIDTH = 6,
+   parameter C_RADIX4    = 0
 )
 (
     input  logic                    Clk_CI,
@@ -66,10 +70,15 @@ module riscv_alu_div
   logic [C_WIDTH-1:0] BMux_D;
   logic [C_WIDTH-1:0] OutMux_D;
 
+  logic [C_WIDTH-1:0] AStep_D;
+  logic [C_WIDTH-1:0] BStep_D;
+  logic [C_WIDTH-1:0] AddOut2_D;
+
   logic [C_LOG_WIDTH-1:0] Cnt_DP, Cnt_DN;
-  logic CntZero_S;
+  logic CntZero_S, CntLast_S;
 
   logic ARegEn_S, BRegEn_S, ResRegEn_S, ABComp_S, PmSel_S, LoadEn_S;
+  logic ABComp2_S, DualStep_S;
 
   enum logic [1:0] {IDLE, DIVIDE, FINISH} State_SN, State_SP;
 
@@ -106,15 +115,33 @@ module riscv_alu_div
   assign AddTmp_D    = (LoadEn_S) ? 0 : AReg_DP;
   assign AddOut_D    = (PmSel_S)  ? AddTmp_D + AddMux_D : AddTmp_D - $signed(AddMux_D);
 
+  ///////////////////////////////////////////////////////////////////////////////
+  // second step (radix-4 only)
+  ///////////////////////////////////////////////////////////////////////////////
+
+  // A and B as they are after the first step of this cycle
+  assign AStep_D     = (ABComp_S) ? AddOut_D : AReg_DP;
+  assign BStep_D     = {CompInv_SP, (BReg_DP[$high(BReg_DP):1])};
+
+  assign ABComp2_S   = ((AStep_D == BStep_D) | ((AStep_D > BStep_D) ^ CompInv_SP)) & ((|AStep_D) | OpBIsZero_SI);
+  assign AddOut2_D   = AStep_D - $signed(BStep_D);
+
+  // the last quotient bit is computed alone if the number of bits is odd
+  assign DualStep_S  = (C_RADIX4 != 0) & ~LoadEn_S & ~CntZero_S;
+
   ///////////////////////////////////////////////////////////////////////////////
   // counter
   ///////////////////////////////////////////////////////////////////////////////
 
-  assign Cnt_DN      = (LoadEn_S)   ? OpBShift_DI :
-                       (~CntZero_S) ? Cnt_DP - 1  : Cnt_DP;
+  assign Cnt_DN      = (LoadEn_S)                ? OpBShift_DI :
+                       (DualStep_S & ~CntLast_S) ? Cnt_DP - 2  :
+                       (~CntZero_S)              ? Cnt_DP - 1  : Cnt_DP;
 
   assign CntZero_S   = ~(|Cnt_DP);
 
+  // one or two bits are left, this is the last divide cycle
+  assign CntLast_S   = (C_RADIX4 != 0) ? ~(|Cnt_DP[$high(Cnt_DP):1]) : CntZero_S;
+
   ///////////////////////////////////////////////////////////////////////////////
   // FSM
   ///////////////////////////////////////////////////////////////////////////////
@@ -148,13 +175,13 @@ module riscv_alu_div
       /////////////////////////////////
       DIVIDE: begin
 
-        ARegEn_S     = ABComp_S;
+        ARegEn_S     = ABComp_S | (DualStep_S & ABComp2_S);
         BRegEn_S     = 1'b1;
         ResRegEn_S   = 1'b1;
 
         // calculation finished
         // one more divide cycle (32nd divide cycle)
-        if (CntZero_S) begin
+        if (CntLast_S) begin
           State_SN   = FINISH;
         end
       end
@@ -182,10 +209,14 @@ module riscv_alu_div
   assign CompInv_SN = (LoadEn_S) ? OpBSign_SI   : CompInv_SP;
   assign ResInv_SN  = (LoadEn_S) ? (~OpBIsZero_SI | OpCode_SI[1]) & OpCode_SI[0] & (OpA_DI[$high(OpA_DI)] ^ OpBSign_SI) : ResInv_SP;
 
-  assign AReg_DN   = (ARegEn_S)   ? AddOut_D : AReg_DP;
-  assign BReg_DN   = (BRegEn_S)   ? BMux_D   : BReg_DP;
-  assign ResReg_DN = (LoadEn_S)   ? '0       :
-                     (ResRegEn_S) ? {ABComp_S, ResReg_DP[$high(ResReg_DP):1]} : ResReg_DP;
+  assign AReg_DN   = (~ARegEn_S)   ? AReg_DP :
+                     (DualStep_S)  ? ((ABComp2_S) ? AddOut2_D : AStep_D) : AddOut_D;
+  assign BReg_DN   = (~BRegEn_S)   ? BReg_DP :
+                     (DualStep_S)  ? {CompInv_SP, (BStep_D[$high(BStep_D):1])} : BMux_D;
+  assign ResReg_DN = (LoadEn_S)    ? '0      :
+                     (~ResRegEn_S) ? ResReg_DP :
+                     (DualStep_S)  ? {ABComp2_S, ABComp_S, ResReg_DP[$high(ResReg_DP):2]} :
+                                     {ABComp_S, ResReg_DP[$high(ResReg_DP):1]};
 
   always_ff @(posedge Clk_CI or negedge Rst_RBI) begin : p_regs
     if(~Rst_RBI) begin
@@ -162,6 +162,8 @@ module riscv_controller
   input logic         reg_d_alu_is_reg_a_i,
   input logic         reg_d_alu_is_reg_b_i,
   input logic         reg_d_alu_is_reg_c_i,
+  input logic         jr_fused_i,                 // jalr target known from the instruction in EX
+  input logic         reg_d_lsu_pending_i,        // register still written by an outstanding load
 
   // stall signals
   output logic        halt_if_o,
@@ -984,11 +986,19 @@ module riscv_controller
       load_stall_o    = 1'b1;
     end
 
+    // Stall because of a load that has left EX but has not got its data yet
+    if (reg_d_lsu_pending_i == 1'b1)
+    begin
+      deassert_we_o   = 1'b1;
+      load_stall_o    = 1'b1;
+    end
+
     // Stall because of jr path
-    // - always stall if a result is to be forwarded to the PC
+    // - always stall if a result is to be forwarded to the PC, unless it was
+    //   fused with a lui/auipc/li in EX
     // we don't care about in which state the ctrl_fsm is as we deassert_we
     // anyway when we are not in DECODE
-    if ((jump_in_dec_i == BRANCH_JALR) &&
+    if ((jump_in_dec_i == BRANCH_JALR) && (~jr_fused_i) &&
         (((regfile_we_wb_i == 1'b1) && (reg_d_wb_is_reg_a_i == 1'b1)) ||
          ((regfile_we_ex_i == 1'b1) && (reg_d_ex_is_reg_a_i == 1'b1)) ||
          ((regfile_alu_we_fw_i == 1'b1) && (reg_d_alu_is_reg_a_i == 1'b1))) )
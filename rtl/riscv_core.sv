@@ -49,7 +49,12 @@ module riscv_core
   parameter SHARED_FP           =  0,
   parameter SHARED_DSP_MULT     =  0,
   parameter SHARED_INT_DIV      =  0,
+  parameter FAST_INT_DIV        =  0, // radix-4 divider with early termination
+  parameter BRANCH_PREDICT      =  0, // predict backward branches taken in IF
+  parameter MACRO_OP_FUSION     =  0, // jalr behind lui/auipc/li without jr stall
+  parameter LSU_OUTSTANDING     =  0, // data requests in flight, 0 waits for each
   parameter SHARED_FP_DIVSQRT   =  0,
+  parameter APU_CUSTOM          =  0, // send OPCODE_APU_CUSTOM to the apu interface
   parameter WAPUTYPE            =  0,
   parameter APU_NARGS_CPU       =  3,
   parameter APU_WOP_CPU         =  6,
@@ -126,7 +131,7 @@ module riscv_core
 
   localparam N_HWLP      = 2;
   localparam N_HWLP_BITS = $clog2(N_HWLP);
-  localparam APU         = ((SHARED_DSP_MULT==1) | (SHARED_INT_DIV==1) | (FPU==1)) ? 1 : 0;
+  localparam APU         = ((SHARED_DSP_MULT==1) | (SHARED_INT_DIV==1) | (FPU==1) | (APU_CUSTOM==1)) ? 1 : 0;
 
   // IF/ID signals
   logic              is_hwlp_id;
@@ -161,6 +166,10 @@ module riscv_core
   logic        branch_in_ex;
   logic        branch_decision;
 
+  // Static branch prediction (IF->ID->IF)
+  logic        branch_pred_id, branch_pred_ex;
+  logic [31:0] branch_fallthrough_ex;
+
   logic        ctrl_busy;
   logic        if_busy;
   logic        lsu_busy;
@@ -264,6 +273,9 @@ module riscv_core
   logic        data_misaligned_ex;
 
   logic [31:0] lsu_rdata;
+  logic [5:0]  lsu_waddr_wb;      // load answered now when LSU_OUTSTANDING > 0
+  logic        lsu_we_wb;
+  logic [63:0] lsu_pending_regs;  // registers outstanding loads still write
 
   // stall control
   logic        halt_if;
@@ -349,7 +361,7 @@ module riscv_core
 
   // APU master signals
    generate
-      if ( SHARED_FP ) begin
+      if ( SHARED_FP || APU_CUSTOM ) begin
          assign apu_master_type_o  = apu_type_ex;
          assign apu_master_flags_o = apu_flags_ex;
          assign fflags_csr         = apu_master_flags_i;
@@ -458,6 +470,7 @@ module riscv_core
     .N_HWLP              ( N_HWLP            ),
     .RDATA_WIDTH         ( INSTR_RDATA_WIDTH ),
     .FPU                 ( FPU               ),
+    .BRANCH_PREDICT      ( BRANCH_PREDICT    ),
     .DM_HaltAddress      ( DM_HaltAddress    )
   )
   if_stage_i
@@ -494,6 +507,7 @@ module riscv_core
     .pc_if_o             ( pc_if             ),
     .pc_id_o             ( pc_id             ),
     .is_fetch_failed_o   ( is_fetch_failed_id ),
+    .branch_pred_id_o    ( branch_pred_id    ),
 
     // control signals
     .clear_instr_valid_i ( clear_instr_valid ),
@@ -517,6 +531,8 @@ module riscv_core
     // Jump targets
     .jump_target_id_i    ( jump_target_id    ),
     .jump_target_ex_i    ( jump_target_ex    ),
+    .branch_pred_ex_i    ( branch_pred_ex    ),
+    .branch_fallthrough_ex_i ( branch_fallthrough_ex ),
 
     // pipeline stalls
     .halt_if_i           ( halt_if           ),
@@ -547,6 +563,8 @@ module riscv_core
     .SHARED_DSP_MULT              ( SHARED_DSP_MULT      ),
     .SHARED_INT_DIV               ( SHARED_INT_DIV       ),
     .SHARED_FP_DIVSQRT            ( SHARED_FP_DIVSQRT    ),
+    .APU_CUSTOM                   ( APU_CUSTOM           ),
+    .MACRO_OP_FUSION              ( MACRO_OP_FUSION      ),
     .WAPUTYPE                     ( WAPUTYPE             ),
     .APU_NARGS_CPU                ( APU_NARGS_CPU        ),
     .APU_WOP_CPU                  ( APU_WOP_CPU          ),
@@ -579,6 +597,9 @@ module riscv_core
     .branch_in_ex_o               ( branch_in_ex         ),
     .branch_decision_i            ( branch_decision      ),
     .jump_target_o                ( jump_target_id       ),
+    .branch_pred_id_i             ( branch_pred_id       ),
+    .branch_pred_ex_o             ( branch_pred_ex       ),
+    .branch_fallthrough_ex_o      ( branch_fallthrough_ex ),
 
     // IF and ID control signals
     .clear_instr_valid_o          ( clear_instr_valid    ),
@@ -727,6 +748,7 @@ module riscv_core
     .regfile_waddr_wb_i           ( regfile_waddr_fw_wb_o),  // Write address ex-wb pipeline
     .regfile_we_wb_i              ( regfile_we_wb        ),  // write enable for the register file
     .regfile_wdata_wb_i           ( regfile_wdata        ),  // write data to commit in the register file
+    .lsu_pending_regs_i           ( lsu_pending_regs     ),
 
     .regfile_alu_waddr_fw_i       ( regfile_alu_waddr_fw ),
     .regfile_alu_we_fw_i          ( regfile_alu_we_fw    ),
@@ -758,6 +780,9 @@ module riscv_core
    .SHARED_FP        ( SHARED_FP          ),
    .SHARED_DSP_MULT  ( SHARED_DSP_MULT    ),
    .SHARED_INT_DIV   ( SHARED_INT_DIV     ),
+   .FAST_INT_DIV     ( FAST_INT_DIV       ),
+   .LSU_OUTSTANDING  ( LSU_OUTSTANDING    ),
+   .APU_CUSTOM       ( APU_CUSTOM         ),
    .APU_NARGS_CPU    ( APU_NARGS_CPU      ),
    .APU_WOP_CPU      ( APU_WOP_CPU        ),
    .APU_NDSFLAGS_CPU ( APU_NDSFLAGS_CPU   ),
@@ -842,6 +867,8 @@ module riscv_core
 
     .lsu_en_i                   ( data_req_ex                  ),
     .lsu_rdata_i                ( lsu_rdata                    ),
+    .lsu_waddr_i                ( lsu_waddr_wb                 ),
+    .lsu_we_i                   ( lsu_we_wb                    ),
 
     // interface with CSRs
     .csr_access_i               ( csr_access_ex                ),
@@ -888,7 +915,11 @@ module riscv_core
   //                                                                                    //
   ////////////////////////////////////////////////////////////////////////////////////////
 
-  riscv_load_store_unit  load_store_unit_i
+  riscv_load_store_unit
+  #(
+    .OUTSTANDING           ( LSU_OUTSTANDING    )
+  )
+  load_store_unit_i
   (
     .clk                   ( clk                ),
     .rst_n                 ( rst_ni             ),
@@ -921,6 +952,12 @@ module riscv_core
     .data_misaligned_ex_i  ( data_misaligned_ex ), // from ID/EX pipeline
     .data_misaligned_o     ( data_misaligned    ),
 
+    .regfile_waddr_ex_i    ( regfile_waddr_ex   ),
+    .regfile_we_ex_i       ( regfile_we_ex      ),
+    .regfile_waddr_wb_o    ( lsu_waddr_wb       ),
+    .regfile_we_wb_o       ( lsu_we_wb          ),
+    .regfile_pending_o     ( lsu_pending_regs   ),
+
     // control signals
     .lsu_ready_ex_o        ( lsu_ready_ex       ),
     .lsu_ready_wb_o        ( lsu_ready_wb       ),
@@ -1186,4 +1223,40 @@ module riscv_core
   );
 `endif
 `endif
+
+
+  // assertions
+  ///////////////////////////////////////////////////////////////////////////////
+
+`ifndef SYNTHESIS
+  // plain checks instead of assert, verilator skips assertions without --assert
+  initial
+  begin : p_assertions
+    // the apu port carries custom instructions only, the accelerator behind
+    // it would run fp instructions as custom ones, private fpu or shared
+    if (APU_CUSTOM == 1 && FPU == 1)
+      $fatal(1, "APU_CUSTOM=1 does not work with FPU=1");
+
+    // two-cycle apu results share the write port of the load store unit,
+    // which can get a response in any cycle with outstanding loads
+    if (LSU_OUTSTANDING > 0 && APU == 1)
+      $fatal(1, "LSU_OUTSTANDING > 0 does not work with an APU");
+
+`ifdef TRACE_EXECUTION
+    // the tracer takes load results from the cycle the load leaves WB, which
+    // no longer waits for the data with outstanding loads
+    if (LSU_OUTSTANDING > 0)
+      $fatal(1, "TRACE_EXECUTION does not work with LSU_OUTSTANDING > 0");
+`endif
+  end
+
+  // p.elw keeps the load in EX until the event arrives and the core sleeps
+  // meanwhile, outstanding loads let EX go on
+  always_ff @(posedge clk)
+  begin : p_elw_outstanding
+    if (LSU_OUTSTANDING > 0 && PULP_CLUSTER == 1 && data_req_ex && data_load_event_ex)
+      $fatal(1, "p.elw does not work with LSU_OUTSTANDING > 0");
+  end
+`endif
+
 endmodule
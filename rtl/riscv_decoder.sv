@@ -38,6 +38,7 @@ module riscv_decoder
   parameter SHARED_DSP_MULT   = 0,
   parameter SHARED_INT_DIV    = 0,
   parameter SHARED_FP_DIVSQRT = 0,
+  parameter APU_CUSTOM        = 0,
   parameter WAPUTYPE          = 0,
   parameter APU_WOP_CPU       = 6
 )
@@ -1237,6 +1238,29 @@ module riscv_decoder
         end
       end
 
+      // accelerator attached to the apu interface, R-type with funct7[5:0]
+      // as the operation. funct3[0] also reads rd as third operand.
+      OPCODE_APU_CUSTOM: begin
+        if (APU_CUSTOM == 1 && instr_rdata_i[31] == 1'b0 &&
+            instr_rdata_i[14:13] == 2'b00) begin
+          apu_en           = 1'b1;
+          alu_en_o         = 1'b0;
+          apu_op_o         = instr_rdata_i[30:25];
+          // results may come back after any number of cycles, multicycle
+          // ops write back on the ALU port where a collision stalls EX
+          apu_lat_o        = 2'h3;
+          rega_used_o      = 1'b1;
+          regb_used_o      = 1'b1;
+          regfile_alu_we   = 1'b1;
+          if (instr_rdata_i[12]) begin
+            regc_used_o        = 1'b1;
+            regc_mux_o         = REGC_RD;
+            alu_op_c_mux_sel_o = OP_C_REGC_OR_FWD;
+          end
+        end else
+          illegal_insn_o = 1'b1;
+      end
+
       ////////////////////////////
       //  ______ _____  _    _  //
       // |  ____|  __ \| |  | | //
@@ -44,6 +44,9 @@ module riscv_ex_stage
   parameter SHARED_FP        =  0,
   parameter SHARED_DSP_MULT  =  0,
   parameter SHARED_INT_DIV   =  0,
+  parameter FAST_INT_DIV     =  0,
+  parameter LSU_OUTSTANDING  =  0,
+  parameter APU_CUSTOM       =  0,
   parameter APU_NARGS_CPU    =  3,
   parameter APU_WOP_CPU      =  6,
   parameter APU_NDSFLAGS_CPU = 15,
@@ -128,6 +131,8 @@ module riscv_ex_stage
 
   input  logic        lsu_en_i,
   input  logic [31:0] lsu_rdata_i,
+  input  logic [5:0]  lsu_waddr_i,    // load written back now, LSU_OUTSTANDING > 0
+  input  logic        lsu_we_i,
 
   // input from ID stage
   input  logic        branch_in_ex_i,
@@ -261,6 +266,7 @@ module riscv_ex_stage
   riscv_alu
   #(
     .SHARED_INT_DIV( SHARED_INT_DIV ),
+    .FAST_INT_DIV  ( FAST_INT_DIV   ),
     .FPU           ( FPU            )
     )
    alu_i
@@ -335,7 +341,7 @@ module riscv_ex_stage
   );
 
    generate
-      if (FPU == 1) begin
+      if (FPU == 1 || APU_CUSTOM == 1) begin
          ////////////////////////////////////////////////////
          //     _    ____  _   _   ____ ___ ____  ____     //
          //    / \  |  _ \| | | | |  _ \_ _/ ___||  _ \    //
@@ -383,7 +389,9 @@ module riscv_ex_stage
          assign apu_perf_wb_o  = wb_contention | wb_contention_lsu;
          assign apu_ready_wb_o = ~(apu_active | apu_en_i | apu_stall) | apu_valid;
 
-         if ( SHARED_FP ) begin
+         // custom accelerators are always external, riscv_core rejects an
+         // fpu next to them
+         if ( SHARED_FP || APU_CUSTOM ) begin
             assign apu_master_req_o      = apu_req;
             assign apu_master_ready_o    = apu_ready;
             assign apu_gnt               = apu_master_gnt_i;
@@ -527,28 +535,37 @@ module riscv_ex_stage
   ///////////////////////////////////////
   // EX/WB Pipeline Register           //
   ///////////////////////////////////////
-  always_ff @(posedge clk, negedge rst_n)
-  begin : EX_WB_Pipeline_Register
-    if (~rst_n)
-    begin
-      regfile_waddr_lsu   <= '0;
-      regfile_we_lsu      <= 1'b0;
-    end
-    else
-    begin
-      if (ex_valid_o) // wb_ready_i is implied
-      begin
-        regfile_we_lsu    <= regfile_we_i & ~lsu_err_i;
-        if (regfile_we_i & ~lsu_err_i ) begin
-          regfile_waddr_lsu <= regfile_waddr_i;
+  generate
+    if (LSU_OUTSTANDING == 0) begin : wb_blocking
+      always_ff @(posedge clk, negedge rst_n)
+      begin : EX_WB_Pipeline_Register
+        if (~rst_n)
+        begin
+          regfile_waddr_lsu   <= '0;
+          regfile_we_lsu      <= 1'b0;
+        end
+        else
+        begin
+          if (ex_valid_o) // wb_ready_i is implied
+          begin
+            regfile_we_lsu    <= regfile_we_i & ~lsu_err_i;
+            if (regfile_we_i & ~lsu_err_i ) begin
+              regfile_waddr_lsu <= regfile_waddr_i;
+            end
+          end else if (wb_ready_i) begin
+            // we are ready for a new instruction, but there is none available,
+            // so we just flush the current one out of the pipe
+            regfile_we_lsu    <= 1'b0;
+          end
         end
-      end else if (wb_ready_i) begin
-        // we are ready for a new instruction, but there is none available,
-        // so we just flush the current one out of the pipe
-        regfile_we_lsu    <= 1'b0;
       end
+    end else begin : wb_lsu_queue
+      // the LSU remembers the destination of every outstanding load and
+      // names the one whose data arrives
+      assign regfile_we_lsu    = lsu_we_i;
+      assign regfile_waddr_lsu = lsu_waddr_i;
     end
-  end
+  endgenerate
 
   // As valid always goes to the right and ready to the left, and we are able
   // to finish branches without going to the WB stage, ex_valid does not
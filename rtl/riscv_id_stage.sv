@@ -50,6 +50,8 @@ module riscv_id_stage
   parameter SHARED_DSP_MULT   =  0,
   parameter SHARED_INT_DIV    =  0,
   parameter SHARED_FP_DIVSQRT =  0,
+  parameter APU_CUSTOM        =  0,
+  parameter MACRO_OP_FUSION   =  0,
   parameter WAPUTYPE          =  0,
   parameter APU_NARGS_CPU     =  3,
   parameter APU_WOP_CPU       =  6,
@@ -80,6 +82,9 @@ module riscv_id_stage
     output logic        branch_in_ex_o,
     input  logic        branch_decision_i,
     output logic [31:0] jump_target_o,
+    input  logic        branch_pred_id_i,   // IF predicted the branch in ID taken
+    output logic        branch_pred_ex_o,
+    output logic [31:0] branch_fallthrough_ex_o,
 
     // IF and ID stage signals
     output logic        clear_instr_valid_o,
@@ -230,6 +235,7 @@ module riscv_id_stage
     input  logic [5:0]  regfile_waddr_wb_i,
     input  logic        regfile_we_wb_i,
     input  logic [31:0] regfile_wdata_wb_i, // From wb_stage: selects data from data memory, ex_stage result and sp rdata
+    input  logic [63:0] lsu_pending_regs_i, // registers outstanding loads still have to write
 
     input  logic [5:0]  regfile_alu_waddr_fw_i,
     input  logic        regfile_alu_we_fw_i,
@@ -267,6 +273,15 @@ module riscv_id_stage
   logic        regc_used_dec;
 
   logic        branch_taken_ex;
+  logic        branch_compressed_ex;
+
+  // Macro-op fusion
+  logic        fuse_const_id;     // instruction in ID writes a value known in decode
+  logic [31:0] fuse_value_id;
+  logic        fuse_valid_ex;     // the one in EX did
+  logic [5:0]  fuse_rd_ex;
+  logic [31:0] fuse_value_ex;
+  logic        jr_fused;          // jalr takes rs1 from the instruction in EX
   logic [1:0]  jump_in_id;
   logic [1:0]  jump_in_dec;
 
@@ -449,6 +464,7 @@ module riscv_id_stage
   logic        reg_d_alu_is_reg_a_id;
   logic        reg_d_alu_is_reg_b_id;
   logic        reg_d_alu_is_reg_c_id;
+  logic        reg_d_lsu_pending_id;
 
   logic        is_clpx, is_subrot;
 
@@ -529,12 +545,23 @@ module riscv_id_stage
   assign reg_d_alu_is_reg_b_id = (regfile_alu_waddr_fw_i == regfile_addr_rb_id) && (regb_used_dec == 1'b1) && (regfile_addr_rb_id != '0);
   assign reg_d_alu_is_reg_c_id = (regfile_alu_waddr_fw_i == regfile_addr_rc_id) && (regc_used_dec == 1'b1) && (regfile_addr_rc_id != '0);
 
+  // an outstanding load still has to write an operand, or the register the ALU
+  // port is about to write and would be overwritten later
+  assign reg_d_lsu_pending_id  = (lsu_pending_regs_i[regfile_addr_ra_id] && (rega_used_dec == 1'b1)) ||
+                                 (lsu_pending_regs_i[regfile_addr_rb_id] && (regb_used_dec == 1'b1)) ||
+                                 (lsu_pending_regs_i[regfile_addr_rc_id] && (regc_used_dec == 1'b1)) ||
+                                 (lsu_pending_regs_i[regfile_alu_waddr_id] && (regfile_alu_we_dec_id == 1'b1));
+
 
   // kill instruction in the IF/ID stage by setting the instr_valid_id control
   // signal to 0 for instructions that are done
   assign clear_instr_valid_o = id_ready_o | halt_id | branch_taken_ex;
 
-  assign branch_taken_ex     = branch_in_ex_o & branch_decision_i;
+  // the branch in EX redirects the fetch when it was mispredicted, IF only
+  // predicts taken branches
+  assign branch_taken_ex     = branch_in_ex_o & (branch_decision_i ^ branch_pred_ex_o);
+
+  assign branch_fallthrough_ex_o = pc_ex_o + (branch_compressed_ex ? 32'h2 : 32'h4);
 
 
   assign mult_en = mult_int_en | mult_dot_en;
@@ -598,15 +625,63 @@ module riscv_id_stage
       JT_JAL:  jump_target = pc_id_i + imm_uj_type;
       JT_COND: jump_target = pc_id_i + imm_sb_type;
 
-      // JALR: Cannot forward RS1, since the path is too long
-      JT_JALR: jump_target = regfile_data_ra_id + imm_i_type;
-      default:  jump_target = regfile_data_ra_id + imm_i_type;
+      // JALR: Cannot forward RS1, since the path is too long, unless its
+      // value was already known when the instruction in EX was decoded
+      JT_JALR: jump_target = (jr_fused ? fuse_value_ex : regfile_data_ra_id) + imm_i_type;
+      default:  jump_target = (jr_fused ? fuse_value_ex : regfile_data_ra_id) + imm_i_type;
     endcase
   end
 
   assign jump_target_o = jump_target;
 
 
+  // Macro-op fusion:
+  // lui, auipc and addi on x0 or on the result of such an instruction
+  // directly before (lui+addi, auipc+addi) write a value that is known in
+  // decode already. It moves along with the instruction to EX, so a jalr right
+  // behind it (auipc+jalr, lui+jalr, li+jalr) computes its target from there
+  // and does not wait for the register file.
+  generate
+    if (MACRO_OP_FUSION != 0) begin : macro_op_fusion
+      logic rs1_fused;
+
+      assign rs1_fused = fuse_valid_ex && (fuse_rd_ex == regfile_addr_ra_id);
+
+      always_comb
+      begin
+        fuse_const_id = 1'b0;
+        fuse_value_id = imm_u_type;
+
+        unique case (instr[6:0])
+          OPCODE_LUI:   fuse_const_id = 1'b1;
+          OPCODE_AUIPC: begin
+            fuse_const_id = 1'b1;
+            fuse_value_id = pc_id_i + imm_u_type;
+          end
+          OPCODE_OPIMM: begin
+            if (instr[14:12] == 3'b000) begin // addi
+              if (instr[`REG_S1] == 5'b0) begin
+                fuse_const_id = 1'b1;
+                fuse_value_id = imm_i_type;
+              end else if (rs1_fused) begin
+                fuse_const_id = 1'b1;
+                fuse_value_id = fuse_value_ex + imm_i_type;
+              end
+            end
+          end
+          default:;
+        endcase
+      end
+
+      assign jr_fused = (jump_in_dec == BRANCH_JALR) && rs1_fused;
+    end else begin : no_macro_op_fusion
+      assign fuse_const_id = 1'b0;
+      assign fuse_value_id = '0;
+      assign jr_fused      = 1'b0;
+    end
+  endgenerate
+
+
   ////////////////////////////////////////////////////////
   //   ___                                 _      _     //
   //  / _ \ _ __   ___ _ __ __ _ _ __   __| |    / \    //
@@ -1019,6 +1094,7 @@ module riscv_id_stage
       .SHARED_DSP_MULT     ( SHARED_DSP_MULT      ),
       .SHARED_INT_DIV      ( SHARED_INT_DIV       ),
       .SHARED_FP_DIVSQRT   ( SHARED_FP_DIVSQRT    ),
+      .APU_CUSTOM          ( APU_CUSTOM           ),
       .WAPUTYPE            ( WAPUTYPE             ),
       .APU_WOP_CPU         ( APU_WOP_CPU          )
       )
@@ -1274,6 +1350,8 @@ module riscv_id_stage
     .reg_d_alu_is_reg_a_i           ( reg_d_alu_is_reg_a_id  ),
     .reg_d_alu_is_reg_b_i           ( reg_d_alu_is_reg_b_id  ),
     .reg_d_alu_is_reg_c_i           ( reg_d_alu_is_reg_c_id  ),
+    .jr_fused_i                     ( jr_fused               ),
+    .reg_d_lsu_pending_i            ( reg_d_lsu_pending_id   ),
 
     // Forwarding signals
     .operand_a_fw_mux_sel_o         ( operand_a_fw_mux_sel   ),
@@ -1457,6 +1535,12 @@ module riscv_id_stage
       pc_ex_o                     <= '0;
 
       branch_in_ex_o              <= 1'b0;
+      branch_pred_ex_o            <= 1'b0;
+      branch_compressed_ex        <= 1'b0;
+
+      fuse_valid_ex               <= 1'b0;
+      fuse_rd_ex                  <= '0;
+      fuse_value_ex               <= '0;
 
     end
     else if (data_misaligned_i) begin
@@ -1572,10 +1656,22 @@ module riscv_id_stage
         end
 
         branch_in_ex_o              <= jump_in_id == BRANCH_COND;
+        if (jump_in_id == BRANCH_COND) begin
+          branch_pred_ex_o          <= branch_pred_id_i;
+          branch_compressed_ex      <= is_compressed_i;
+        end
+
+        fuse_valid_ex               <= fuse_const_id && regfile_alu_we_id && (regfile_alu_waddr_id != '0);
+        if (fuse_const_id) begin
+          fuse_rd_ex                <= regfile_alu_waddr_id;
+          fuse_value_ex             <= fuse_value_id;
+        end
       end else if(ex_ready_i) begin
         // EX stage is ready but we don't have a new instruction for it,
         // so we set all write enables to 0, but unstall the pipe
 
+        fuse_valid_ex               <= 1'b0;
+
         regfile_we_ex_o             <= 1'b0;
 
         regfile_alu_we_ex_o         <= 1'b0;
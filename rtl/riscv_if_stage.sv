@@ -22,6 +22,8 @@
 //                                                                            //
 // Description:    Instruction fetch unit: Selection of the next PC, and      //
 //                 buffering (sampling) of the read instruction               //
+//                 With BRANCH_PREDICT backward conditional branches are      //
+//                 predicted taken and fetching continues at their target.    //
 //                                                                            //
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -33,6 +35,7 @@ module riscv_if_stage
   parameter N_HWLP          = 2,
   parameter RDATA_WIDTH     = 32,
   parameter FPU             = 0,
+  parameter BRANCH_PREDICT  = 0,
   parameter DM_HaltAddress  = 32'h1A110800
 )
 (
@@ -67,6 +70,7 @@ module riscv_if_stage
     output logic       [31:0] pc_if_o,
     output logic       [31:0] pc_id_o,
     output logic              is_fetch_failed_o,
+    output logic              branch_pred_id_o,      // instruction in ID is a branch predicted taken
 
     // Forwarding ports - control signals
     input  logic        clear_instr_valid_i,   // clear instruction valid bit in IF/ID pipe
@@ -83,6 +87,8 @@ module riscv_if_stage
     // jump and branch target and decision
     input  logic [31:0] jump_target_id_i,      // jump target address
     input  logic [31:0] jump_target_ex_i,      // jump target address
+    input  logic        branch_pred_ex_i,      // branch in EX was predicted taken
+    input  logic [31:0] branch_fallthrough_ex_i, // next PC of the branch in EX if not taken
 
     // from hwloop controller
     input  logic [N_HWLP-1:0] [31:0] hwlp_start_i,          // hardware loop start addresses
@@ -125,6 +131,12 @@ module riscv_if_stage
   logic [23:0]       trap_base_addr;
   logic              fetch_failed;
 
+  // static branch prediction
+  logic              branch_pred;           // instruction leaving IF is predicted taken
+  logic       [31:0] branch_pred_target;
+  logic              branch_pred_q;         // fetch from the predicted target now
+  logic       [31:0] branch_pred_target_q;
+
 
   // exception PC selection mux
   always_comb
@@ -153,7 +165,8 @@ module riscv_if_stage
     unique case (pc_mux_i)
       PC_BOOT:      fetch_addr_n = {boot_addr_i, 1'b0};
       PC_JUMP:      fetch_addr_n = jump_target_id_i;
-      PC_BRANCH:    fetch_addr_n = jump_target_ex_i;
+      // a branch predicted taken only redirects when it is not taken
+      PC_BRANCH:    fetch_addr_n = branch_pred_ex_i ? branch_fallthrough_ex_i : jump_target_ex_i;
       PC_EXCEPTION: fetch_addr_n = exc_pc;             // set PC to exception handler
       PC_MRET:      fetch_addr_n = mepc_i; // PC is restored when returning from IRQ/exception
       PC_URET:      fetch_addr_n = uepc_i; // PC is restored when returning from IRQ/exception
@@ -161,6 +174,9 @@ module riscv_if_stage
       PC_FENCEI:    fetch_addr_n = pc_id_o + 4; // jump to next instr forces prefetch buffer reload
       default:;
     endcase
+
+    if (branch_pred_q && !pc_set_i)
+      fetch_addr_n = branch_pred_target_q;
   end
 
   generate
@@ -291,6 +307,13 @@ module riscv_if_stage
       branch_req    = 1'b1;
       offset_fsm_ns = WAIT;
     end
+    else if (branch_pred_q) begin
+      // the branch went to ID in the last cycle, drop what follows it
+      valid = 1'b0;
+
+      branch_req    = 1'b1;
+      offset_fsm_ns = WAIT;
+    end
     else begin
       if(hwlp_branch)
         valid = 1'b0;
@@ -348,6 +371,43 @@ module riscv_if_stage
     .illegal_instr_o ( illegal_c_insn       )
   );
 
+  // Pre-decode the instruction that goes to ID: a conditional branch with a
+  // negative offset is most likely closing a loop. Its target is fetched in
+  // the next cycle, as for a jump in ID, instead of after the branch resolved
+  // in EX. A branch at the end of a hardware loop is left alone, if it is not
+  // taken the prefetcher continues at the start of the loop.
+  generate
+    if (BRANCH_PREDICT != 0) begin : branch_predictor
+      logic [31:0] imm_sb_type;
+
+      assign imm_sb_type = { {19 {instr_decompressed[31]}}, instr_decompressed[31], instr_decompressed[7],
+                             instr_decompressed[30:25], instr_decompressed[11:8], 1'b0 };
+
+      assign branch_pred        = (instr_decompressed[6:0] == OPCODE_BRANCH) & instr_decompressed[31] &
+                                  ~illegal_c_insn & ~fetch_failed & ~hwlp_jump;
+      assign branch_pred_target = fetch_addr + imm_sb_type;
+    end else begin : no_branch_predictor
+      assign branch_pred        = 1'b0;
+      assign branch_pred_target = '0;
+    end
+  endgenerate
+
+  always_ff @(posedge clk, negedge rst_n)
+  begin : BRANCH_PREDICTION
+    if (rst_n == 1'b0)
+    begin
+      branch_pred_q        <= 1'b0;
+      branch_pred_target_q <= '0;
+    end
+    else
+    begin
+      branch_pred_q <= if_valid & branch_pred;
+
+      if (if_valid & branch_pred)
+        branch_pred_target_q <= branch_pred_target;
+    end
+  end
+
   // prefetch -> IF registers
   always_ff @(posedge clk, negedge rst_n)
   begin
@@ -375,6 +435,7 @@ module riscv_if_stage
       is_hwlp_id_q          <= 1'b0;
       hwlp_dec_cnt_id_o     <= '0;
       is_fetch_failed_o     <= 1'b0;
+      branch_pred_id_o      <= 1'b0;
 
     end
     else
@@ -389,6 +450,7 @@ module riscv_if_stage
         pc_id_o             <= pc_if_o;
         is_hwlp_id_q        <= fetch_is_hwlp;
         is_fetch_failed_o   <= 1'b0;
+        branch_pred_id_o    <= branch_pred;
 
         if (fetch_is_hwlp)
           hwlp_dec_cnt_id_o   <= hwlp_dec_cnt_if;
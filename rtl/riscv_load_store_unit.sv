@@ -20,11 +20,18 @@
 //                                                                            //
 // Description:    Load Store Unit, used to eliminate multiple access during  //
 //                 processor stalls, and to align bytes and halfwords         //
+//                 With OUTSTANDING > 0 up to that many requests can wait     //
+//                 for their response while the pipeline goes on, the        //
+//                 registers they still have to write are reported in         //
+//                 regfile_pending_o.                                         //
 //                                                                            //
 ////////////////////////////////////////////////////////////////////////////////
 
 
 module riscv_load_store_unit
+#(
+  parameter OUTSTANDING = 0
+)
 (
     input  logic         clk,
     input  logic         rst_n,
@@ -57,6 +64,13 @@ module riscv_load_store_unit
     input  logic         data_misaligned_ex_i, // misaligned access in last ld/st   -> from ID/EX pipeline
     output logic         data_misaligned_o,    // misaligned access was detected    -> to controller
 
+    // destination register of loads, only used with OUTSTANDING > 0
+    input  logic [5:0]   regfile_waddr_ex_i,   // destination of the load in EX     -> from ex stage
+    input  logic         regfile_we_ex_i,
+    output logic [5:0]   regfile_waddr_wb_o,   // destination of the data arriving  -> to ex stage
+    output logic         regfile_we_wb_o,
+    output logic [63:0]  regfile_pending_o,    // registers still waiting for data  -> to ID stage
+
     // stall signal
     output logic         lsu_ready_ex_o, // LSU ready for new data in EX stage
     output logic         lsu_ready_wb_o, // LSU ready for new data in WB stage
@@ -81,8 +95,6 @@ module riscv_load_store_unit
   logic         misaligned_st;   // high if we are currently performing the second part of a misaligned store
 
 
-  enum logic [1:0]  { IDLE, WAIT_RVALID, WAIT_RVALID_EX_STALL, IDLE_EX_STALL } CS, NS;
-
   logic [31:0]  rdata_q;
 
   ///////////////////////////////// BE generation ////////////////////////////////
@@ -155,26 +167,6 @@ module riscv_load_store_unit
   end
 
 
-  // FF for rdata alignment and sign-extension
-  always_ff @(posedge clk, negedge rst_n)
-  begin
-    if(rst_n == 1'b0)
-    begin
-      data_type_q     <= '0;
-      rdata_offset_q  <= '0;
-      data_sign_ext_q <= '0;
-      data_we_q       <= 1'b0;
-    end
-    else if (data_gnt_i == 1'b1) // request was granted, we wait for rvalid and can continue to WB
-    begin
-      data_type_q     <= data_type_ex_i;
-      rdata_offset_q  <= data_addr_int[1:0];
-      data_sign_ext_q <= data_sign_ext_ex_i;
-      data_we_q       <= data_we_ex_i;
-    end
-  end
-
-
   ////////////////////////////////////////////////////////////////////////
   //  ____  _               _____      _                 _              //
   // / ___|(_) __ _ _ __   | ____|_  _| |_ ___ _ __  ___(_) ___  _ __   //
@@ -303,154 +295,343 @@ module riscv_load_store_unit
   end
 
 
+  // request handling: with OUTSTANDING == 0 every access waits for its rvalid
+  // before the next one can leave EX, otherwise up to OUTSTANDING accesses
+  // are in flight and their loads are written back when the data arrives
+  generate
+    if (OUTSTANDING == 0) begin : lsu_blocking
+      enum logic [1:0]  { IDLE, WAIT_RVALID, WAIT_RVALID_EX_STALL, IDLE_EX_STALL } CS, NS;
 
-  always_ff @(posedge clk, negedge rst_n)
-  begin
-    if(rst_n == 1'b0)
-    begin
-      CS            <= IDLE;
-      rdata_q       <= '0;
-    end
-    else
-    begin
-      CS            <= NS;
-
-      if (data_rvalid_i && (~data_we_q))
+      // FF for rdata alignment and sign-extension
+      always_ff @(posedge clk, negedge rst_n)
       begin
-        // if we have detected a misaligned access, and we are
-        // currently doing the first part of this access, then
-        // store the data coming from memory in rdata_q.
-        // In all other cases, rdata_q gets the value that we are
-        // writing to the register file
-        if ((data_misaligned_ex_i == 1'b1) || (data_misaligned_o == 1'b1))
-          rdata_q  <= data_rdata_i;
-        else
-          rdata_q  <= data_rdata_ext;
+        if(rst_n == 1'b0)
+        begin
+          data_type_q     <= '0;
+          rdata_offset_q  <= '0;
+          data_sign_ext_q <= '0;
+          data_we_q       <= 1'b0;
+        end
+        else if (data_gnt_i == 1'b1) // request was granted, we wait for rvalid and can continue to WB
+        begin
+          data_type_q     <= data_type_ex_i;
+          rdata_offset_q  <= data_addr_int[1:0];
+          data_sign_ext_q <= data_sign_ext_ex_i;
+          data_we_q       <= data_we_ex_i;
+        end
       end
-    end
-  end
 
-  // output to register file
-  assign data_rdata_ex_o = (data_rvalid_i == 1'b1) ? data_rdata_ext : rdata_q;
 
-  // output to data interface
-  assign data_addr_o   = data_addr_int;
-  assign data_wdata_o  = data_wdata;
-  assign data_we_o     = data_we_ex_i;
-  assign data_be_o     = data_be;
-
-  assign misaligned_st = data_misaligned_ex_i;
-
-  // FSM
-  always_comb
-  begin
-    NS             = CS;
-
-    data_req_o     = 1'b0;
-
-    lsu_ready_ex_o = 1'b1;
-    lsu_ready_wb_o = 1'b1;
-
-    case(CS)
-      // starts from not active and stays in IDLE until request was granted
-      IDLE:
+      always_ff @(posedge clk, negedge rst_n)
       begin
-        data_req_o = data_req_ex_i;
-
-        if(data_req_ex_i) begin
-          lsu_ready_ex_o = 1'b0;
-
-          if(data_gnt_i) begin
-            lsu_ready_ex_o = 1'b1;
-
-            if (ex_valid_i)
-              NS = WAIT_RVALID;
+        if(rst_n == 1'b0)
+        begin
+          CS            <= IDLE;
+          rdata_q       <= '0;
+        end
+        else
+        begin
+          CS            <= NS;
+
+          if (data_rvalid_i && (~data_we_q))
+          begin
+            // if we have detected a misaligned access, and we are
+            // currently doing the first part of this access, then
+            // store the data coming from memory in rdata_q.
+            // In all other cases, rdata_q gets the value that we are
+            // writing to the register file
+            if ((data_misaligned_ex_i == 1'b1) || (data_misaligned_o == 1'b1))
+              rdata_q  <= data_rdata_i;
             else
-              NS = WAIT_RVALID_EX_STALL;
-          end
-
-          if(data_err_i) begin
-            lsu_ready_ex_o = 1'b1;
+              rdata_q  <= data_rdata_ext;
           end
-
         end
-      end //~ IDLE
+      end
 
-      // wait for rvalid in WB stage and send a new request if there is any
-      WAIT_RVALID:
+      // FSM
+      always_comb
       begin
-        lsu_ready_wb_o = 1'b0;
+        NS             = CS;
 
-        if (data_rvalid_i) begin
-          // we don't have to wait for anything here as we are the only stall
-          // source for the WB stage
-          lsu_ready_wb_o = 1'b1;
+        data_req_o     = 1'b0;
 
-          data_req_o = data_req_ex_i;
+        lsu_ready_ex_o = 1'b1;
+        lsu_ready_wb_o = 1'b1;
 
-          if (data_req_ex_i) begin
-            lsu_ready_ex_o = 1'b0;
+        case(CS)
+          // starts from not active and stays in IDLE until request was granted
+          IDLE:
+          begin
+            data_req_o = data_req_ex_i;
 
-            if (data_gnt_i) begin
-              lsu_ready_ex_o = 1'b1;
+            if(data_req_ex_i) begin
+              lsu_ready_ex_o = 1'b0;
+
+              if(data_gnt_i) begin
+                lsu_ready_ex_o = 1'b1;
+
+                if (ex_valid_i)
+                  NS = WAIT_RVALID;
+                else
+                  NS = WAIT_RVALID_EX_STALL;
+              end
 
-              if(ex_valid_i)
-                NS = WAIT_RVALID;
-              else
-                NS = WAIT_RVALID_EX_STALL;
-            end else begin
               if(data_err_i) begin
                 lsu_ready_ex_o = 1'b1;
               end
-              NS = IDLE;
+
             end
-          end else begin
+          end //~ IDLE
+
+          // wait for rvalid in WB stage and send a new request if there is any
+          WAIT_RVALID:
+          begin
+            lsu_ready_wb_o = 1'b0;
+
+            if (data_rvalid_i) begin
+              // we don't have to wait for anything here as we are the only stall
+              // source for the WB stage
+              lsu_ready_wb_o = 1'b1;
+
+              data_req_o = data_req_ex_i;
+
+              if (data_req_ex_i) begin
+                lsu_ready_ex_o = 1'b0;
+
+                if (data_gnt_i) begin
+                  lsu_ready_ex_o = 1'b1;
+
+                  if(ex_valid_i)
+                    NS = WAIT_RVALID;
+                  else
+                    NS = WAIT_RVALID_EX_STALL;
+                end else begin
+                  if(data_err_i) begin
+                    lsu_ready_ex_o = 1'b1;
+                  end
+                  NS = IDLE;
+                end
+              end else begin
+                if (data_rvalid_i) begin
+                  // no request, so go to IDLE
+                  NS = IDLE;
+                end
+              end
+            end
+          end
+
+          // wait for rvalid while still in EX stage
+          // we end up here when there was an EX stall, so in this cycle we just
+          // wait and don't send new requests
+          WAIT_RVALID_EX_STALL:
+          begin
+            data_req_o = 1'b0;
+
             if (data_rvalid_i) begin
-              // no request, so go to IDLE
+              if (ex_valid_i) begin
+                // we are done and can go back to idle
+                // the data is safely stored already
+                NS = IDLE;
+              end else begin
+                // we have to wait until ex_stall is deasserted
+                NS = IDLE_EX_STALL;
+              end
+            end else begin
+              // we didn't yet receive the rvalid, so we check the ex_stall
+              // signal. If we are no longer stalled we can change to the "normal"
+              // WAIT_RVALID state
+              if (ex_valid_i)
+                NS = WAIT_RVALID;
+            end
+          end
+
+          IDLE_EX_STALL:
+          begin
+            // wait for us to be unstalled and then change back to IDLE state
+            if (ex_valid_i) begin
               NS = IDLE;
             end
           end
-        end
+
+          default: begin
+            NS = IDLE;
+          end
+        endcase
       end
 
-      // wait for rvalid while still in EX stage
-      // we end up here when there was an EX stall, so in this cycle we just
-      // wait and don't send new requests
-      WAIT_RVALID_EX_STALL:
+      assign busy_o = (CS == WAIT_RVALID) || (CS == WAIT_RVALID_EX_STALL) || (CS == IDLE_EX_STALL) || (data_req_o == 1'b1);
+
+      // every load is written back before the next one leaves EX
+      assign regfile_waddr_wb_o = '0;
+      assign regfile_we_wb_o    = 1'b0;
+      assign regfile_pending_o  = '0;
+
+      `ifndef VERILATOR
+        // make sure there is no new request when the old one is not yet completely done
+        assert property (
+          @(posedge clk) ((CS == WAIT_RVALID) && (data_gnt_i == 1'b1)) |-> (data_rvalid_i == 1'b1) ) else $display("It should not be possible to get a grand without an rvalid for the last request %t", $time);
+
+        assert property (
+          @(posedge clk) (CS == IDLE) |-> (data_rvalid_i == 1'b0) ) else $display("There should be no rvalid when we the LSU is IDLE %t", $time);
+      `endif
+    end else begin : lsu_nonblocking
+      // requests that got their grant and still wait for rvalid, in the order
+      // they were sent; index 0 is the one the next rvalid belongs to
+      logic [0:OUTSTANDING-1]       valid_n,    valid_Q;
+      logic [0:OUTSTANDING-1]       we_n,       we_Q;
+      logic [0:OUTSTANDING-1] [1:0] type_n,     type_Q;
+      logic [0:OUTSTANDING-1] [1:0] offset_n,   offset_Q;
+      logic [0:OUTSTANDING-1]       sign_ext_n, sign_ext_Q;
+      logic [0:OUTSTANDING-1]       first_n,    first_Q;    // first part of a misaligned access
+      logic [0:OUTSTANDING-1] [5:0] rd_n,       rd_Q;
+      logic [0:OUTSTANDING-1]       rd_we_n,    rd_we_Q;
+
+      logic                         granted_Q;  // access in EX was granted while EX was stalled
+      logic                         push;
+
+      assign push = data_req_o & data_gnt_i;
+
+      // send the access in EX unless it went out already or there is no
+      // space left to remember it
+      assign data_req_o     = data_req_ex_i & (~granted_Q) & (~valid_Q[OUTSTANDING-1]);
+
+      assign lsu_ready_ex_o = (~data_req_ex_i) | granted_Q | push | data_err_i;
+      // the data is written back whenever it arrives, nothing waits in WB
+      assign lsu_ready_wb_o = 1'b1;
+
+      always_comb
       begin
-        data_req_o = 1'b0;
-
+        valid_n    = valid_Q;
+        we_n       = we_Q;
+        type_n     = type_Q;
+        offset_n   = offset_Q;
+        sign_ext_n = sign_ext_Q;
+        first_n    = first_Q;
+        rd_n       = rd_Q;
+        rd_we_n    = rd_we_Q;
+
+        // the head is done when its data arrives, move everything by one step
         if (data_rvalid_i) begin
-          if (ex_valid_i) begin
-            // we are done and can go back to idle
-            // the data is safely stored already
-            NS = IDLE;
-          end else begin
-            // we have to wait until ex_stall is deasserted
-            NS = IDLE_EX_STALL;
+          for (int j = 0; j < OUTSTANDING - 1; j++)
+          begin
+            valid_n[j]    = valid_Q[j + 1];
+            we_n[j]       = we_Q[j + 1];
+            type_n[j]     = type_Q[j + 1];
+            offset_n[j]   = offset_Q[j + 1];
+            sign_ext_n[j] = sign_ext_Q[j + 1];
+            first_n[j]    = first_Q[j + 1];
+            rd_n[j]       = rd_Q[j + 1];
+            rd_we_n[j]    = rd_we_Q[j + 1];
+          end
+          valid_n[OUTSTANDING-1] = 1'b0;
+        end
+
+        // the access granted now goes behind the last one that is waiting
+        if (push) begin
+          for (int j = 0; j < OUTSTANDING; j++) begin
+            if (~valid_n[j]) begin
+              valid_n[j]    = 1'b1;
+              we_n[j]       = data_we_ex_i;
+              type_n[j]     = data_type_ex_i;
+              offset_n[j]   = data_addr_int[1:0];
+              sign_ext_n[j] = data_sign_ext_ex_i;
+              first_n[j]    = data_misaligned_o;
+              rd_n[j]       = regfile_waddr_ex_i;
+              // the first part of a misaligned load does not write anything
+              rd_we_n[j]    = regfile_we_ex_i & (~data_misaligned_o);
+
+              break;
+            end
           end
-        end else begin
-          // we didn't yet receive the rvalid, so we check the ex_stall
-          // signal. If we are no longer stalled we can change to the "normal"
-          // WAIT_RVALID state
-          if (ex_valid_i)
-            NS = WAIT_RVALID;
         end
       end
 
-      IDLE_EX_STALL:
+      always_ff @(posedge clk, negedge rst_n)
       begin
-        // wait for us to be unstalled and then change back to IDLE state
-        if (ex_valid_i) begin
-          NS = IDLE;
+        if(rst_n == 1'b0)
+        begin
+          valid_Q       <= '0;
+          we_Q          <= '0;
+          type_Q        <= '0;
+          offset_Q      <= '0;
+          sign_ext_Q    <= '0;
+          first_Q       <= '0;
+          rd_Q          <= '0;
+          rd_we_Q       <= '0;
+          granted_Q     <= 1'b0;
+          rdata_q       <= '0;
+        end
+        else
+        begin
+          valid_Q       <= valid_n;
+          we_Q          <= we_n;
+          type_Q        <= type_n;
+          offset_Q      <= offset_n;
+          sign_ext_Q    <= sign_ext_n;
+          first_Q       <= first_n;
+          rd_Q          <= rd_n;
+          rd_we_Q       <= rd_we_n;
+
+          // don't send the access again while EX is stalled
+          if (ex_valid_i)
+            granted_Q   <= 1'b0;
+          else if (push)
+            granted_Q   <= 1'b1;
+
+          if (data_rvalid_i && (~we_Q[0]))
+          begin
+            // the first part of a misaligned access is kept as it came from
+            // memory, the second part is combined with it
+            if (first_Q[0])
+              rdata_q  <= data_rdata_i;
+            else
+              rdata_q  <= data_rdata_ext;
+          end
         end
       end
 
-      default: begin
-        NS = IDLE;
+      // rdata alignment and sign-extension follow the head
+      assign data_type_q     = type_Q[0];
+      assign rdata_offset_q  = offset_Q[0];
+      assign data_sign_ext_q = sign_ext_Q[0];
+      assign data_we_q       = we_Q[0];
+
+      assign regfile_we_wb_o    = data_rvalid_i & rd_we_Q[0];
+      assign regfile_waddr_wb_o = rd_Q[0];
+
+      // registers an outstanding load still has to write, the head is
+      // forwarded from WB in the cycle its data arrives
+      always_comb
+      begin
+        regfile_pending_o = '0;
+
+        for (int j = 0; j < OUTSTANDING; j++) begin
+          if (valid_Q[j] && rd_we_Q[j] && ((j != 0) || (~data_rvalid_i)))
+            regfile_pending_o[rd_Q[j]] = 1'b1;
+        end
+
+        regfile_pending_o[0] = 1'b0;
       end
-    endcase
-  end
+
+      assign busy_o = (|valid_Q) || (data_req_o == 1'b1);
+
+      `ifndef VERILATOR
+        assert property (
+          @(posedge clk) (data_rvalid_i) |-> (valid_Q[0]) ) else $display("There should be no rvalid without an outstanding request %t", $time);
+      `endif
+    end
+  endgenerate
+
+  // output to register file
+  assign data_rdata_ex_o = (data_rvalid_i == 1'b1) ? data_rdata_ext : rdata_q;
+
+  // output to data interface
+  assign data_addr_o   = data_addr_int;
+  assign data_wdata_o  = data_wdata;
+  assign data_we_o     = data_we_ex_i;
+  assign data_be_o     = data_be;
+
+  assign misaligned_st = data_misaligned_ex_i;
 
   // check for misaligned accesses that need a second memory access
   // If one is detected, this is signaled with data_misaligned_o to
@@ -479,21 +660,12 @@ module riscv_load_store_unit
   // generate address from operands
   assign data_addr_int = (addr_useincr_ex_i) ? (operand_a_ex_i + operand_b_ex_i) : operand_a_ex_i;
 
-  assign busy_o = (CS == WAIT_RVALID) || (CS == WAIT_RVALID_EX_STALL) || (CS == IDLE_EX_STALL) || (data_req_o == 1'b1);
-
 
   //////////////////////////////////////////////////////////////////////////////
   // Assertions
   //////////////////////////////////////////////////////////////////////////////
 
   `ifndef VERILATOR
-    // make sure there is no new request when the old one is not yet completely done
-    assert property (
-      @(posedge clk) ((CS == WAIT_RVALID) && (data_gnt_i == 1'b1)) |-> (data_rvalid_i == 1'b1) ) else $display("It should not be possible to get a grand without an rvalid for the last request %t", $time);
-
-    assert property (
-      @(posedge clk) (CS == IDLE) |-> (data_rvalid_i == 1'b0) ) else $display("There should be no rvalid when we the LSU is IDLE %t", $time);
-
     // assert that the address does not contain X when request is sent
     assert property ( @(posedge clk) (data_req_o) |-> (!$isunknown(data_addr_o)) ) else $display("There has been a data request but the address is unknown %t", $time);
   `endif
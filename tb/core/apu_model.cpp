@@ -0,0 +1,407 @@
+// Copyright 2019 ETH Zurich and University of Bologna.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Model of accelerators on the apu interface of the cores (see apu_stub.sv),
+// for trying out custom instructions before writing any RTL, and for sizing
+// units shared by several cores. The operations are plain C++ functions in
+// apu_ops below, each with a latency (cycles from the start to the result),
+// an initiation interval (cycles until the unit takes the next operation,
+// equal to the latency for an unpipelined unit) and the class of unit it runs
+// on. Every class has a number of identical units shared by all cores.
+//
+// A request is granted when the core has nothing else waiting for a unit. It
+// then queues until a unit of its class is free, the arbiter decides which of
+// the queued requests goes first. Results come back to every core in order, at
+// most one per cycle. The dispatcher of a core keeps at most two operations in
+// flight.
+//
+// With APU_CUSTOM=1 the core sends OPCODE_APU_CUSTOM to the accelerators:
+//
+//   .insn r 0x3b, 0, <op>, rd, rs1, rs2     rd = f(rs1, rs2, 0)
+//   .insn r 0x3b, 1, <op>, rd, rs1, rs2     rd = f(rs1, rs2, rd)
+//
+// The timing can be changed without recompiling, one setting per line from
+// +apu_cfg=<file> or from the plusargs in apu_stub.sv:
+//
+//   latency <cycles>                     for all operations
+//   interval <cycles>
+//   op <n> latency <cycles>              for operation n
+//   op <n> interval <cycles>
+//   unit <class> count <n>               number of units of a class
+//   arbiter fifo|rr|fixed                oldest request, round robin over the
+//                                        cores or lowest core first
+//
+// Numbers are in C notation, # starts a comment.
+
+#include "svdpi.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#define APU_MAX_OPS   64
+#define APU_MAX_UNITS 16 // per class
+
+typedef uint32_t (*apu_fn)(uint32_t a, uint32_t b, uint32_t c);
+
+enum apu_class { UNIT_DSP, UNIT_CRYPTO, UNIT_DIV, NUM_CLASSES };
+
+struct apu_op {
+    const char *name;
+    apu_fn fn;
+    apu_class unit;
+    unsigned latency;
+    unsigned interval;
+
+    // statistics
+    uint64_t count;
+};
+
+static uint32_t ror(uint32_t x, unsigned n)
+{
+    return x >> n | x << (32 - n);
+}
+
+// c + a * b
+static uint32_t op_mac(uint32_t a, uint32_t b, uint32_t c)
+{
+    return c + a * b;
+}
+
+// c + dot product of the four signed bytes in a and b
+static uint32_t op_dot4(uint32_t a, uint32_t b, uint32_t c)
+{
+    for (int i = 0; i < 32; i += 8)
+        c += (int8_t)(a >> i) * (int8_t)(b >> i);
+    return c;
+}
+
+// sha-256 message schedule: c + sigma0(a) + sigma1(b)
+static uint32_t op_sha256_sig(uint32_t a, uint32_t b, uint32_t c)
+{
+    uint32_t s0 = ror(a, 7) ^ ror(a, 18) ^ a >> 3;
+    uint32_t s1 = ror(b, 17) ^ ror(b, 19) ^ b >> 10;
+    return c + s0 + s1;
+}
+
+// unsigned division, iterative
+static uint32_t op_divu(uint32_t a, uint32_t b, uint32_t)
+{
+    return b ? a / b : ~0u;
+}
+
+static struct apu_op apu_ops[APU_MAX_OPS] = {
+    {"mac",        op_mac,        UNIT_DSP,    2, 1, 0},
+    {"dot4",       op_dot4,       UNIT_DSP,    2, 1, 0},
+    {"sha256_sig", op_sha256_sig, UNIT_CRYPTO, 1, 1, 0},
+    {"divu",       op_divu,       UNIT_DIV,    8, 8, 0},
+};
+
+struct apu_result {
+    bool started;
+    uint64_t due;
+    uint64_t accepted;
+    uint32_t value;
+};
+
+struct apu_request {
+    int port;
+    int op;
+    apu_result *res;
+};
+
+struct apu_unit {
+    const char *name;
+    unsigned count;
+    uint64_t next_free[APU_MAX_UNITS];
+    std::deque<apu_request> waiting;
+
+    // statistics
+    uint64_t issued;
+    uint64_t busy_cycles;
+};
+
+struct apu_port {
+    // handshake in this cycle
+    bool req;
+    bool gnt;
+    int op;
+    uint32_t operand[3];
+
+    // accepted operations, oldest first
+    std::deque<apu_result> results;
+    unsigned queued;
+
+    // statistics
+    uint64_t issued;
+    uint64_t nack_cycles;  // waiting for the grant
+    uint64_t queue_cycles; // waiting for a unit
+    uint64_t latency_sum;  // from the grant to the result
+};
+
+enum apu_arbiter { ARB_FIFO, ARB_RR, ARB_FIXED };
+
+static struct apu_model {
+    apu_unit unit[NUM_CLASSES] = {
+        {"dsp", 1, {0}, {}, 0, 0},
+        {"crypto", 1, {0}, {}, 0, 0},
+        {"div", 1, {0}, {}, 0, 0},
+    };
+    std::vector<apu_port> port;
+    apu_arbiter arbiter = ARB_FIFO;
+    unsigned rr         = 0; // port with the highest priority
+    uint64_t cycle      = 0;
+} apu;
+
+static void apu_model_error(const std::string &line, const char *what)
+{
+    fprintf(stderr, "apu_model: %s: %s\n", what, line.c_str());
+    exit(1);
+}
+
+extern "C" void apu_model_config(const char *cfg)
+{
+    std::string line(cfg);
+    std::istringstream in(line.substr(0, line.find('#')));
+    std::string key, word;
+    unsigned long val;
+    int first = 0, last = APU_MAX_OPS - 1;
+
+    if (!(in >> key))
+        return;
+
+    if (key == "arbiter") {
+        in >> word;
+        if (word == "fifo")
+            apu.arbiter = ARB_FIFO;
+        else if (word == "rr")
+            apu.arbiter = ARB_RR;
+        else if (word == "fixed")
+            apu.arbiter = ARB_FIXED;
+        else
+            apu_model_error(line, "arbiter is fifo, rr or fixed");
+        return;
+    }
+
+    if (key == "unit") {
+        std::string name, opt;
+        in >> name >> opt >> word;
+        val = strtoul(word.c_str(), NULL, 0);
+        for (apu_unit &u : apu.unit) {
+            if (name != u.name)
+                continue;
+            if (opt != "count")
+                apu_model_error(line, "expected unit <class> count <n>");
+            if (val < 1 || val > APU_MAX_UNITS)
+                apu_model_error(line, "count is 1..16");
+            u.count = val;
+            return;
+        }
+        apu_model_error(line, "unknown unit class");
+    }
+
+    if (key == "op") {
+        if (!(in >> word))
+            apu_model_error(line, "expected op <n> <option> <cycles>");
+        first = last = strtoul(word.c_str(), NULL, 0);
+        if (first >= APU_MAX_OPS)
+            apu_model_error(line, "op is 0..63");
+        key = "";
+        in >> key;
+    }
+
+    if (!(in >> word))
+        apu_model_error(line, "expected a number of cycles");
+    val = strtoul(word.c_str(), NULL, 0);
+    if (!val)
+        apu_model_error(line, "cycles must be positive");
+
+    for (int i = first; i <= last; i++) {
+        if (key == "latency")
+            apu_ops[i].latency = val;
+        else if (key == "interval")
+            apu_ops[i].interval = val;
+        else
+            apu_model_error(line, "unknown setting");
+    }
+}
+
+extern "C" void apu_model_config_file(const char *path)
+{
+    std::ifstream file(path);
+    std::string line;
+
+    if (!file) {
+        fprintf(stderr, "apu_model: cannot open %s\n", path);
+        exit(1);
+    }
+    while (std::getline(file, line))
+        apu_model_config(line.c_str());
+}
+
+// One cycle of the model is apu_model_port for every core, apu_model_cycle
+// and apu_model_out for every core.
+
+// Handshake of a core in this cycle.
+extern "C" void apu_model_port(int p, svBit req, svBit gnt, int op, int a,
+                               int b, int c)
+{
+    if (p >= (int)apu.port.size())
+        apu.port.resize(p + 1);
+
+    apu_port &port  = apu.port[p];
+    port.req        = req;
+    port.gnt        = gnt;
+    port.op         = op;
+    port.operand[0] = a;
+    port.operand[1] = b;
+    port.operand[2] = c;
+}
+
+// position of port p in the current priority order
+static unsigned apu_prio(int p)
+{
+    unsigned n = apu.port.size();
+    if (apu.arbiter == ARB_FIXED)
+        return p;
+    return (p + n - apu.rr) % n;
+}
+
+extern "C" void apu_model_cycle()
+{
+    unsigned n = apu.port.size();
+
+    apu.cycle++;
+
+    // queue the requests granted in this cycle, in priority order
+    for (unsigned i = 0; i < n; i++) {
+        int p = apu.arbiter == ARB_FIXED ? i : (apu.rr + i) % n;
+        apu_port &port = apu.port[p];
+
+        if (port.req && !port.gnt) {
+            port.nack_cycles++;
+            continue;
+        }
+        if (!port.req)
+            continue;
+
+        int op = port.op;
+        if (op < 0 || op >= APU_MAX_OPS || !apu_ops[op].fn) {
+            fprintf(stderr, "apu_model: unknown operation %d from core %d\n",
+                    op, p);
+            exit(1);
+        }
+
+        apu_op &o = apu_ops[op];
+        port.results.push_back({false, 0, apu.cycle,
+                                o.fn(port.operand[0], port.operand[1],
+                                     port.operand[2])});
+        port.queued++;
+        port.issued++;
+        o.count++;
+        apu.unit[o.unit].waiting.push_back({p, op, &port.results.back()});
+    }
+
+    // start what the units can take
+    for (apu_unit &u : apu.unit) {
+        while (!u.waiting.empty()) {
+            unsigned free = 0;
+            while (free < u.count && u.next_free[free] > apu.cycle)
+                free++;
+            if (free == u.count)
+                break;
+
+            // the oldest request goes first, or the one of the core with the
+            // highest priority
+            auto next = u.waiting.begin();
+            if (apu.arbiter != ARB_FIFO)
+                for (auto it = u.waiting.begin(); it != u.waiting.end(); ++it)
+                    if (apu_prio(it->port) < apu_prio(next->port))
+                        next = it;
+
+            apu_op &o   = apu_ops[next->op];
+            apu_port &port = apu.port[next->port];
+            next->res->started = true;
+            next->res->due     = apu.cycle + o.latency;
+            port.queued--;
+            port.queue_cycles += apu.cycle - next->res->accepted;
+            u.next_free[free] = apu.cycle + o.interval;
+            u.issued++;
+            u.busy_cycles += o.interval;
+            u.waiting.erase(next);
+        }
+    }
+
+    if (n)
+        apu.rr = (apu.rr + 1) % n;
+}
+
+// Grant and result of a core for the next cycle.
+extern "C" void apu_model_out(int p, svBit *ready, svBit *valid, int *result)
+{
+    apu_port &port = apu.port[p];
+
+    *ready  = port.queued == 0;
+    *valid  = 0;
+    *result = 0;
+    if (!port.results.empty() && port.results.front().started
+        && port.results.front().due <= apu.cycle + 1) {
+        *valid  = 1;
+        *result = port.results.front().value;
+        port.latency_sum += apu.cycle + 1 - port.results.front().accepted;
+        port.results.pop_front();
+    }
+}
+
+extern "C" void apu_model_report()
+{
+    uint64_t total = 0;
+
+    for (int i = 0; i < APU_MAX_OPS; i++) {
+        if (!apu_ops[i].count)
+            continue;
+        printf("apu_model: op %2d %-12s %llu issued, latency %u, "
+               "interval %u\n",
+               i, apu_ops[i].name, (unsigned long long)apu_ops[i].count,
+               apu_ops[i].latency, apu_ops[i].interval);
+        total += apu_ops[i].count;
+    }
+    if (!total)
+        return;
+
+    for (const apu_unit &u : apu.unit) {
+        if (!u.issued)
+            continue;
+        printf("apu_model: unit %-6s %u x, %llu issued, %.1f%% busy\n",
+               u.name, u.count, (unsigned long long)u.issued,
+               100.0 * u.busy_cycles / (apu.cycle * u.count));
+    }
+    for (unsigned p = 0; p < apu.port.size(); p++) {
+        const apu_port &port = apu.port[p];
+        if (!port.issued)
+            continue;
+        printf("apu_model: core %u %llu issued, %llu cycles waiting for a "
+               "grant, %llu for a unit, %.2f cycles avg latency\n",
+               p, (unsigned long long)port.issued,
+               (unsigned long long)port.nack_cycles,
+               (unsigned long long)port.queue_cycles,
+               (double)port.latency_sum / port.issued);
+    }
+}
@@ -0,0 +1,89 @@
+// Copyright 2019 ETH Zurich and University of Bologna.
+// Copyright and related rights are licensed under the Solderpad Hardware
+// License, Version 0.51 (the "License"); you may not use this file except in
+// compliance with the License.  You may obtain a copy of the License at
+// http://solderpad.org/licenses/SHL-0.51. Unless required by applicable law
+// or agreed to in writing, software, hardware and materials distributed under
+// this License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+// Accelerators on the apu interface of RI5CY for prototyping custom
+// instructions, shared by the NB_PORTS cores connected to it. What the
+// operations compute, how long they take and how many units there are is up
+// to the model in apu_model.cpp.
+
+module apu_stub
+    #(parameter NB_PORTS = 1,
+      parameter APU_NARGS_CPU = 3,
+      parameter APU_WOP_CPU = 6)
+    (input logic                                          clk_i,
+     input logic                                          rst_ni,
+
+     input logic [NB_PORTS-1:0]                           req_i,
+     input logic [NB_PORTS-1:0]                           ready_i, // the cores always are
+     output logic [NB_PORTS-1:0]                          gnt_o,
+     input logic [NB_PORTS-1:0][APU_NARGS_CPU-1:0][31:0]  operands_i,
+     input logic [NB_PORTS-1:0][APU_WOP_CPU-1:0]          op_i,
+
+     output logic [NB_PORTS-1:0]                          valid_o,
+     output logic [NB_PORTS-1:0][31:0]                    result_o);
+
+    import "DPI-C" function void apu_model_config(input string line);
+    import "DPI-C" function void apu_model_config_file(input string path);
+    import "DPI-C" function void apu_model_port
+        (input int port, input bit req, input bit gnt, input int op,
+         input int a, input int b, input int c);
+    import "DPI-C" function void apu_model_cycle();
+    import "DPI-C" function void apu_model_out
+        (input int port, output bit ready, output bit valid, output int result);
+    import "DPI-C" function void apu_model_report();
+
+    bit                                                   ready, valid;
+    int                                                   result;
+    logic [NB_PORTS-1:0]                                  ready_q;
+
+    // configure the model, see apu_model.cpp for the format
+    initial begin: apu_model_cfg
+        automatic string cfg;
+        automatic int    val;
+
+        if ($value$plusargs("apu_cfg=%s", cfg))
+            apu_model_config_file(cfg);
+        if ($value$plusargs("apu_latency=%d", val))
+            apu_model_config($sformatf("latency %0d", val));
+        if ($value$plusargs("apu_interval=%d", val))
+            apu_model_config($sformatf("interval %0d", val));
+        if ($value$plusargs("apu_arbiter=%s", cfg))
+            apu_model_config({"arbiter ", cfg});
+    end
+
+    final begin: apu_model_stats
+        apu_model_report();
+    end
+
+    assign gnt_o = req_i & ready_q;
+
+    always_ff @(posedge clk_i, negedge rst_ni) begin: model
+        if (~rst_ni) begin
+            ready_q  <= '1;
+            valid_o  <= '0;
+            result_o <= '0;
+
+        end else begin
+            for (int p = 0; p < NB_PORTS; p++)
+                apu_model_port(p, req_i[p], gnt_o[p], 32'(op_i[p]),
+                               operands_i[p][0], operands_i[p][1],
+                               operands_i[p][2]);
+            apu_model_cycle();
+            for (int p = 0; p < NB_PORTS; p++) begin
+                apu_model_out(p, ready, valid, result);
+                ready_q[p]  <= ready;
+                valid_o[p]  <= valid;
+                result_o[p] <= result;
+            end
+
+        end
+    end
+
+endmodule // apu_stub
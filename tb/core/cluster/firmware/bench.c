@@ -0,0 +1,177 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+
+// Benchmarks for all cores of tb_cluster_verilator at once. Every phase
+// starts and ends with a barrier, core 0 prints the cycles of the slowest
+// core. The phases stress the tcdm differently:
+//
+//   sieve        private data on the stack of every core
+//   blocked      c = a + b, every core takes a contiguous chunk
+//   interleaved  c = a - b, core i takes the words i, i + n, ...
+//   hot spot     every core updates its own counter, all in the same bank
+
+#include "firmware.h"
+
+#define NB_CORES_REG (*(volatile uint32_t *)0x20000008)
+#define NB_BANKS_REG (*(volatile uint32_t *)0x2000000c)
+
+#define MAX_CORES   16
+#define MAX_BANKS   32
+#define VEC_WORDS   1024
+#define SIEVE_LIMIT 4096
+#define SIEVE_COUNT 564 // primes below SIEVE_LIMIT
+#define HOT_UPDATES 256
+
+static uint32_t a[VEC_WORDS], b[VEC_WORDS], c[VEC_WORDS];
+static volatile uint32_t hot[MAX_CORES * MAX_BANKS];
+
+// there are no atomics, every core waits for its own flag in turn
+static volatile uint32_t arrived[MAX_CORES];
+static volatile uint32_t released;
+static uint32_t phase_cycles[MAX_CORES];
+
+static void barrier(int id, int n)
+{
+    uint32_t gen = released + 1;
+
+    arrived[id] = gen;
+    if (id == 0) {
+        for (int i = 1; i < n; i++)
+            while (arrived[i] != gen)
+                ;
+        released = gen;
+    } else {
+        while (released != gen)
+            ;
+    }
+}
+
+static int sieve_private(void)
+{
+    uint32_t bitmap[SIEVE_LIMIT / 64]; // odd numbers only
+    int count = 1;
+
+    for (int i = 0; i < SIEVE_LIMIT / 64; i++)
+        bitmap[i] = 0;
+
+    for (int i = 3; i < SIEVE_LIMIT; i += 2) {
+        if (bitmap[i / 64] & 1 << (i / 2 % 32))
+            continue;
+        count++;
+        for (int j = 3 * i; j < SIEVE_LIMIT; j += 2 * i)
+            bitmap[j / 64] |= 1 << (j / 2 % 32);
+    }
+    return count;
+}
+
+static void add_blocked(int id, int n)
+{
+    int chunk = VEC_WORDS / n;
+    int end   = id == n - 1 ? VEC_WORDS : (id + 1) * chunk;
+
+    for (int i = id * chunk; i < end; i++)
+        c[i] = a[i] + b[i];
+}
+
+static void sub_interleaved(int id, int n)
+{
+    for (int i = id; i < VEC_WORDS; i += n)
+        c[i] = a[i] - b[i];
+}
+
+static void hot_spot(int id, int banks)
+{
+    volatile uint32_t *counter = &hot[id * banks];
+
+    for (int i = 0; i < HOT_UPDATES; i++)
+        *counter += i;
+}
+
+static bool check_add(void)
+{
+    for (int i = 0; i < VEC_WORDS; i++)
+        if (c[i] != a[i] + b[i])
+            return false;
+    return true;
+}
+
+static bool check_sub(void)
+{
+    for (int i = 0; i < VEC_WORDS; i++)
+        if (c[i] != a[i] - b[i])
+            return false;
+    return true;
+}
+
+// wait for all cores, print how long the slowest one took and check the
+// result before anybody starts the next phase
+static int phase_end(int id, int n, const char *name, uint32_t start,
+                     bool (*check)(void))
+{
+    int err = 0;
+
+    phase_cycles[id] = cycles() - start;
+    barrier(id, n);
+    if (id == 0) {
+        uint32_t max = 0;
+        for (int i = 0; i < n; i++)
+            if (phase_cycles[i] > max)
+                max = phase_cycles[i];
+        print_str(name);
+        print_dec(max);
+        print_str(" cycles\n");
+        err = check && !check();
+    }
+    barrier(id, n);
+    return err;
+}
+
+int cluster_main(int id)
+{
+    int n     = NB_CORES_REG;
+    int banks = NB_BANKS_REG < MAX_BANKS ? NB_BANKS_REG : MAX_BANKS;
+    int err   = 0;
+    uint32_t start;
+
+    // count cycles
+    __asm__ volatile("csrw 0x7A0, %0" ::"r"(1));
+    __asm__ volatile("csrw 0x7A1, %0" ::"r"(1));
+
+    if (id == 0) {
+        for (int i = 0; i < VEC_WORDS; i++) {
+            a[i] = i * 3;
+            b[i] = 0x1000 - i;
+        }
+        print_str("running on ");
+        print_dec(n);
+        print_str(" cores, ");
+        print_dec(banks);
+        print_str(" banks\n");
+    }
+    barrier(id, n);
+
+    start = cycles();
+    err |= sieve_private() != SIEVE_COUNT;
+    err |= phase_end(id, n, "sieve ........ ", start, 0);
+
+    start = cycles();
+    add_blocked(id, n);
+    err |= phase_end(id, n, "blocked ...... ", start, check_add);
+
+    start = cycles();
+    sub_interleaved(id, n);
+    err |= phase_end(id, n, "interleaved .. ", start, check_sub);
+
+    start = cycles();
+    hot_spot(id, banks);
+    err |= phase_end(id, n, "hot spot ..... ", start, 0);
+    err |= hot[id * banks] != HOT_UPDATES * (HOT_UPDATES - 1) / 2;
+
+    if (err)
+        print_str("wrong result\n");
+    return err;
+}
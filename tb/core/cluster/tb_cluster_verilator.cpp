@@ -0,0 +1,213 @@
+// Copyright 2019 ETH Zurich and University of Bologna.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Harness for tb_cluster_verilator.sv. It runs the cluster until every
+// started core has written its exit value and then reports per core and for
+// the whole cluster how many instructions were retired, how many accesses
+// went to the tcdm and how often they lost arbitration for their bank.
+// The output of the cores is collected line by line, prefixed with the core.
+
+#include "svdpi.h"
+#include "Vtb_cluster_verilator__Dpi.h"
+#include "Vtb_cluster_verilator.h"
+#include "verilated_vcd_c.h"
+#include "verilated.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+double sc_time_stamp();
+
+struct cluster_core {
+    bool exited;
+    int exit_value;
+    uint64_t cycles; // until the exit
+    uint64_t instrs;
+    uint64_t accesses;  // granted tcdm accesses
+    uint64_t conflicts; // cycles a tcdm access was not granted
+    std::string line;
+};
+
+struct cluster_bank {
+    uint64_t accesses;
+    uint64_t conflicts;
+};
+
+static struct cluster {
+    int nb_banks = 1;
+    int active   = 0;
+    int exited   = 0;
+    uint64_t cycle = 0;
+    std::vector<cluster_core> core;
+    std::vector<cluster_bank> bank;
+} cluster;
+
+static vluint64_t t = 0;
+Vtb_cluster_verilator *top;
+
+extern "C" void cluster_config(int nb_cores, int nb_banks, int active)
+{
+    cluster.nb_banks = nb_banks;
+    cluster.active   = active;
+    cluster.core.assign(nb_cores, cluster_core());
+    cluster.bank.assign(nb_banks, cluster_bank());
+}
+
+extern "C" void cluster_port(int core, svBit req, svBit gnt, int addr,
+                             svBit retired)
+{
+    cluster_core &c = cluster.core[core];
+    cluster_bank &b = cluster.bank[((uint32_t)addr >> 2) % cluster.nb_banks];
+
+    if (core >= cluster.active || c.exited)
+        return;
+
+    c.cycles++;
+    c.instrs += retired;
+    if (req && gnt) {
+        c.accesses++;
+        b.accesses++;
+    } else if (req) {
+        c.conflicts++;
+        b.conflicts++;
+    }
+}
+
+extern "C" void cluster_cycle()
+{
+    cluster.cycle++;
+}
+
+extern "C" void cluster_putc(int core, int ch)
+{
+    cluster_core &c = cluster.core[core];
+
+    if (ch != '\n') {
+        c.line += (char)ch;
+        return;
+    }
+    printf("[core %d] %s\n", core, c.line.c_str());
+    c.line.clear();
+}
+
+extern "C" void cluster_exit(int core, int value)
+{
+    cluster_core &c = cluster.core[core];
+
+    if (c.exited)
+        return;
+    if (!c.line.empty())
+        cluster_putc(core, '\n');
+    c.exited     = true;
+    c.exit_value = value;
+    cluster.exited++;
+}
+
+static double ratio(uint64_t a, uint64_t b)
+{
+    return b ? (double)a / b : 0.0;
+}
+
+static void cluster_report()
+{
+    uint64_t instrs = 0, accesses = 0, conflicts = 0;
+
+    printf("cluster: %d of %zu cores, %d banks, %llu cycles\n", cluster.active,
+           cluster.core.size(), cluster.nb_banks,
+           (unsigned long long)cluster.cycle);
+    printf("cluster: core   instrs      cycles   ipc   tcdm accesses"
+           "  conflicts\n");
+    for (int i = 0; i < cluster.active; i++) {
+        const cluster_core &c = cluster.core[i];
+        printf("cluster: %4d %8llu %11llu  %.2f  %14llu  %8llu (%.1f%%)\n", i,
+               (unsigned long long)c.instrs, (unsigned long long)c.cycles,
+               ratio(c.instrs, c.cycles), (unsigned long long)c.accesses,
+               (unsigned long long)c.conflicts,
+               100.0 * ratio(c.conflicts, c.accesses + c.conflicts));
+        instrs += c.instrs;
+        accesses += c.accesses;
+        conflicts += c.conflicts;
+    }
+    printf("cluster: total %llu instrs, ipc %.2f, %llu tcdm accesses, "
+           "%.1f%% conflicts\n",
+           (unsigned long long)instrs, ratio(instrs, cluster.cycle),
+           (unsigned long long)accesses,
+           100.0 * ratio(conflicts, accesses + conflicts));
+    for (int i = 0; i < cluster.nb_banks; i++) {
+        const cluster_bank &b = cluster.bank[i];
+        printf("cluster: bank %2d %10llu accesses, %.1f%% busy, "
+               "%llu conflicts\n",
+               i, (unsigned long long)b.accesses,
+               100.0 * ratio(b.accesses, cluster.cycle),
+               (unsigned long long)b.conflicts);
+    }
+}
+
+int main(int argc, char **argv, char **env)
+{
+    bool failed = false;
+
+    Verilated::commandArgs(argc, argv);
+    Verilated::traceEverOn(true);
+    top = new Vtb_cluster_verilator();
+
+#ifdef VCD_TRACE
+    VerilatedVcdC *tfp = new VerilatedVcdC;
+    top->trace(tfp, 99);
+    tfp->open("verilator_cluster.vcd");
+#endif
+    top->clk_i  = 0;
+    top->rst_ni = 0;
+
+    top->eval();
+
+    while (!Verilated::gotFinish()
+           && (!cluster.active || cluster.exited < cluster.active)) {
+        if (t > 40)
+            top->rst_ni = 1;
+        top->clk_i = !top->clk_i;
+        top->eval();
+#ifdef VCD_TRACE
+        tfp->dump(t);
+#endif
+        t += 5;
+    }
+    top->final();
+#ifdef VCD_TRACE
+    tfp->close();
+#endif
+
+    cluster_report();
+    for (int i = 0; i < cluster.active; i++) {
+        if (!cluster.core[i].exited)
+            printf("core %d did not finish\n", i);
+        else if (cluster.core[i].exit_value)
+            printf("core %d exited with %d\n", i, cluster.core[i].exit_value);
+        else
+            continue;
+        failed = true;
+    }
+    printf(failed ? "TEST(S) FAILED!\n" : "ALL TESTS PASSED\n");
+
+    delete top;
+    exit(failed);
+}
+
+double sc_time_stamp()
+{
+    return t;
+}
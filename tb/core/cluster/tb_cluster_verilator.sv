@@ -0,0 +1,255 @@
+// Copyright 2019 ETH Zurich and University of Bologna.
+// Copyright and related rights are licensed under the Solderpad Hardware
+// License, Version 0.51 (the "License"); you may not use this file except in
+// compliance with the License.  You may obtain a copy of the License at
+// http://solderpad.org/licenses/SHL-0.51. Unless required by applicable law
+// or agreed to in writing, software, hardware and materials distributed under
+// this License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+// Top level of a verilator testbench with NB_CORES RI5CY cores sharing the
+// banked memory in tcdm.sv, like the cores of a PULP cluster without the rest
+// of the SoC. All cores boot the same firmware and tell apart by mhartid.
+// Only the first +cluster_cores=N cores are started, so one build serves
+// scaling studies. The statistics and the end of the simulation are handled
+// by tb_cluster_verilator.cpp.
+//
+// Every core has its own pseudo peripherals:
+//
+//   0x1000_0000  w  print a character
+//   0x2000_0000  w  123456789 passed, 1 failed (stops the core)
+//   0x2000_0004  w  exit value (stops the core)
+//   0x2000_0008  r  number of started cores
+//   0x2000_000c  r  number of banks
+
+module tb_cluster_verilator
+    #(parameter NB_CORES = 4,
+      parameter NB_BANKS = 8,
+      parameter CLUSTER_ID = 0,
+      parameter INSTR_RDATA_WIDTH = 128,
+      parameter RAM_ADDR_WIDTH = 20,
+      parameter BOOT_ADDR = 'h80)
+    (input logic clk_i,
+     input logic rst_ni);
+
+    import "DPI-C" function void cluster_config
+        (input int nb_cores, input int nb_banks, input int active);
+    import "DPI-C" function void cluster_port
+        (input int core, input bit req, input bit gnt, input int addr,
+         input bit retired);
+    import "DPI-C" function void cluster_cycle();
+    import "DPI-C" function void cluster_putc(input int core, input int ch);
+    import "DPI-C" function void cluster_exit(input int core, input int value);
+
+    logic [NB_CORES-1:0]                     fetch_enable;
+    int                                      active_cores;
+
+    // signals connecting the cores to the memory
+    logic [NB_CORES-1:0]                     instr_req;
+    logic [NB_CORES-1:0]                     instr_gnt;
+    logic [NB_CORES-1:0]                     instr_rvalid;
+    logic [NB_CORES-1:0][31:0]               instr_addr;
+    logic [NB_CORES-1:0][127:0]              instr_rdata;
+    logic [NB_CORES-1:0][RAM_ADDR_WIDTH-1:0] instr_addr_ram;
+
+    logic [NB_CORES-1:0]                     data_req;
+    logic [NB_CORES-1:0]                     data_gnt;
+    logic [NB_CORES-1:0]                     data_rvalid;
+    logic [NB_CORES-1:0][31:0]               data_addr;
+    logic [NB_CORES-1:0]                     data_we;
+    logic [NB_CORES-1:0][3:0]                data_be;
+    logic [NB_CORES-1:0][31:0]               data_rdata;
+    logic [NB_CORES-1:0][31:0]               data_wdata;
+
+    // data accesses to the tcdm and to the pseudo peripherals
+    logic [NB_CORES-1:0]                     periph;
+    logic [NB_CORES-1:0]                     tcdm_req;
+    logic [NB_CORES-1:0]                     tcdm_gnt;
+    logic [NB_CORES-1:0]                     tcdm_rvalid;
+    logic [NB_CORES-1:0][31:0]               tcdm_rdata;
+    logic [NB_CORES-1:0][RAM_ADDR_WIDTH-1:0] tcdm_addr;
+    logic [NB_CORES-1:0]                     periph_rvalid_q;
+    logic [NB_CORES-1:0][31:0]               periph_rdata_q;
+
+    // instructions leaving the decoder, for the statistics
+    logic [NB_CORES-1:0]                     retired;
+
+    // we either load the provided firmware or stop right away
+    initial begin: load_prog
+        automatic logic [1023:0] firmware;
+
+        if($value$plusargs("firmware=%s", firmware)) begin
+            if($test$plusargs("verbose"))
+                $display("[TESTBENCH] %t: loading firmware %0s ...",
+                         $time, firmware);
+            $readmemh(firmware, tcdm_i.mem);
+
+        end else begin
+            $display("No firmware specified");
+            $finish;
+        end
+    end
+
+    initial begin: start_cores
+        if (!$value$plusargs("cluster_cores=%d", active_cores))
+            active_cores = NB_CORES;
+        if (active_cores < 1 || active_cores > NB_CORES) begin
+            $display("+cluster_cores must be 1..%0d", NB_CORES);
+            $finish;
+        end
+        for (int i = 0; i < NB_CORES; i++)
+            fetch_enable[i] = i < active_cores;
+        cluster_config(NB_CORES, NB_BANKS, active_cores);
+    end
+
+    for (genvar i = 0; i < NB_CORES; i++) begin: core
+        riscv_core
+            #(.INSTR_RDATA_WIDTH (INSTR_RDATA_WIDTH),
+              .PULP_SECURE(0),
+              .FPU(0))
+        riscv_core_i
+            (
+             .clk_i                  ( clk_i           ),
+             .rst_ni                 ( rst_ni          ),
+
+             .clock_en_i             ( '1              ),
+             .test_en_i              ( '0              ),
+
+             .boot_addr_i            ( BOOT_ADDR       ),
+             .core_id_i              ( 4'(i)           ),
+             .cluster_id_i           ( 6'(CLUSTER_ID)  ),
+
+             .instr_addr_o           ( instr_addr[i]   ),
+             .instr_req_o            ( instr_req[i]    ),
+             .instr_rdata_i          ( instr_rdata[i]  ),
+             .instr_gnt_i            ( instr_gnt[i]    ),
+             .instr_rvalid_i         ( instr_rvalid[i] ),
+
+             .data_addr_o            ( data_addr[i]    ),
+             .data_wdata_o           ( data_wdata[i]   ),
+             .data_we_o              ( data_we[i]      ),
+             .data_req_o             ( data_req[i]     ),
+             .data_be_o              ( data_be[i]      ),
+             .data_rdata_i           ( data_rdata[i]   ),
+             .data_gnt_i             ( data_gnt[i]     ),
+             .data_rvalid_i          ( data_rvalid[i]  ),
+
+             .apu_master_req_o       (                 ),
+             .apu_master_ready_o     (                 ),
+             .apu_master_gnt_i       ( 1'b0            ),
+             .apu_master_operands_o  (                 ),
+             .apu_master_op_o        (                 ),
+             .apu_master_type_o      (                 ),
+             .apu_master_flags_o     (                 ),
+             .apu_master_valid_i     ( 1'b0            ),
+             .apu_master_result_i    ( '0              ),
+             .apu_master_flags_i     ( '0              ),
+
+             .irq_i                  ( 1'b0            ),
+             .irq_id_i               ( '0              ),
+             .irq_ack_o              (                 ),
+             .irq_id_o               (                 ),
+             .irq_sec_i              ( 1'b0            ),
+
+             .sec_lvl_o              (                 ),
+
+             .debug_req_i            ( 1'b0            ),
+
+             .fetch_enable_i         ( fetch_enable[i] ),
+             .core_busy_o            (                 ),
+
+             .ext_perf_counters_i    ( '0              ),
+             .fregfile_disable_i     ( 1'b0            ));
+
+        assign retired[i] = riscv_core_i.id_valid & riscv_core_i.is_decoding;
+    end
+
+    // split the data accesses between the tcdm and the pseudo peripherals
+    always_comb begin
+        for (int i = 0; i < NB_CORES; i++) begin
+            instr_addr_ram[i] = instr_addr[i][RAM_ADDR_WIDTH-1:0];
+            tcdm_addr[i]      = data_addr[i][RAM_ADDR_WIDTH-1:0];
+            periph[i]         = data_addr[i] >= 2 ** RAM_ADDR_WIDTH;
+            tcdm_req[i]       = data_req[i] & ~periph[i];
+            data_gnt[i]       = periph[i] ? data_req[i] : tcdm_gnt[i];
+            data_rvalid[i]    = tcdm_rvalid[i] | periph_rvalid_q[i];
+            data_rdata[i]     = periph_rvalid_q[i] ? periph_rdata_q[i]
+                                                   : tcdm_rdata[i];
+        end
+    end
+
+    always_ff @(posedge clk_i, negedge rst_ni) begin: peripherals
+        if (~rst_ni) begin
+            periph_rvalid_q <= '0;
+            periph_rdata_q  <= '0;
+
+        end else begin
+            for (int i = 0; i < NB_CORES; i++) begin
+                periph_rvalid_q[i] <= data_req[i] & periph[i];
+                periph_rdata_q[i]  <= '0;
+
+                if (data_req[i] && periph[i] && data_we[i]) begin
+                    if (data_addr[i] == 32'h1000_0000)
+                        cluster_putc(i, 32'(data_wdata[i][7:0]));
+                    else if (data_addr[i] == 32'h2000_0000
+                             && data_wdata[i] == 123456789)
+                        cluster_exit(i, 0);
+                    else if (data_addr[i] == 32'h2000_0000
+                             && data_wdata[i] == 1)
+                        cluster_exit(i, 1);
+                    else if (data_addr[i] == 32'h2000_0004)
+                        cluster_exit(i, data_wdata[i]);
+                    else
+                        $display("core %0d: out of bounds write to %08x with %08x",
+                                 i, data_addr[i], data_wdata[i]);
+
+                end else if (data_req[i] && periph[i]) begin
+                    if (data_addr[i] == 32'h2000_0008)
+                        periph_rdata_q[i] <= active_cores;
+                    else if (data_addr[i] == 32'h2000_000c)
+                        periph_rdata_q[i] <= NB_BANKS;
+                    else begin
+                        $display("core %0d: out of bounds read from %08x",
+                                 i, data_addr[i]);
+                        $finish;
+                    end
+                end
+            end
+        end
+    end
+
+    // hand every cycle to the statistics
+    always_ff @(posedge clk_i) begin: statistics
+        if (rst_ni) begin
+            for (int i = 0; i < NB_CORES; i++)
+                cluster_port(i, tcdm_req[i], tcdm_gnt[i], data_addr[i],
+                             retired[i]);
+            cluster_cycle();
+        end
+    end
+
+    tcdm
+        #(.NB_PORTS (NB_CORES),
+          .NB_BANKS (NB_BANKS),
+          .ADDR_WIDTH (RAM_ADDR_WIDTH))
+    tcdm_i
+        (.clk_i          ( clk_i          ),
+         .rst_ni         ( rst_ni         ),
+
+         .instr_req_i    ( instr_req      ),
+         .instr_addr_i   ( instr_addr_ram ),
+         .instr_rdata_o  ( instr_rdata    ),
+         .instr_rvalid_o ( instr_rvalid   ),
+         .instr_gnt_o    ( instr_gnt      ),
+
+         .data_req_i     ( tcdm_req       ),
+         .data_addr_i    ( tcdm_addr      ),
+         .data_we_i      ( data_we        ),
+         .data_be_i      ( data_be        ),
+         .data_wdata_i   ( data_wdata     ),
+         .data_rdata_o   ( tcdm_rdata     ),
+         .data_rvalid_o  ( tcdm_rvalid    ),
+         .data_gnt_o     ( tcdm_gnt       ));
+
+endmodule // tb_cluster_verilator
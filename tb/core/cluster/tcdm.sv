@@ -0,0 +1,117 @@
+// Copyright 2019 ETH Zurich and University of Bologna.
+// Copyright and related rights are licensed under the Solderpad Hardware
+// License, Version 0.51 (the "License"); you may not use this file except in
+// compliance with the License.  You may obtain a copy of the License at
+// http://solderpad.org/licenses/SHL-0.51. Unless required by applicable law
+// or agreed to in writing, software, hardware and materials distributed under
+// this License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+// Memory shared by the cores of tb_cluster_verilator, banked like the TCDM of
+// a PULP cluster. The data ports are word interleaved over NB_BANKS banks.
+// Every bank serves one access per cycle, if several cores want the same bank
+// a round robin arbiter per bank picks one and the others have to retry. The
+// instruction ports read the same memory without contention, as if every core
+// had its own instruction cache that always hits.
+
+module tcdm
+    #(parameter NB_PORTS = 4,
+      parameter NB_BANKS = 8, // power of two
+      parameter ADDR_WIDTH = 20)
+    (input logic                                clk_i,
+     input logic                                rst_ni,
+
+     input logic [NB_PORTS-1:0]                 instr_req_i,
+     input logic [NB_PORTS-1:0][ADDR_WIDTH-1:0] instr_addr_i,
+     output logic [NB_PORTS-1:0][127:0]         instr_rdata_o,
+     output logic [NB_PORTS-1:0]                instr_rvalid_o,
+     output logic [NB_PORTS-1:0]                instr_gnt_o,
+
+     input logic [NB_PORTS-1:0]                 data_req_i,
+     input logic [NB_PORTS-1:0][ADDR_WIDTH-1:0] data_addr_i,
+     input logic [NB_PORTS-1:0]                 data_we_i,
+     input logic [NB_PORTS-1:0][3:0]            data_be_i,
+     input logic [NB_PORTS-1:0][31:0]           data_wdata_i,
+     output logic [NB_PORTS-1:0][31:0]          data_rdata_o,
+     output logic [NB_PORTS-1:0]                data_rvalid_o,
+     output logic [NB_PORTS-1:0]                data_gnt_o);
+
+    localparam bytes     = 2**ADDR_WIDTH;
+    localparam BANK_BITS = NB_BANKS > 1 ? $clog2(NB_BANKS) : 1;
+    localparam PORT_BITS = NB_PORTS > 1 ? $clog2(NB_PORTS) : 1;
+
+    logic [7:0]                                 mem[bytes];
+
+    logic [NB_PORTS-1:0][BANK_BITS-1:0]         bank;
+    logic [NB_PORTS-1:0][ADDR_WIDTH-1:0]        word_addr;
+    // port with the highest priority and the winner of every bank
+    logic [NB_BANKS-1:0][PORT_BITS-1:0]         rr_q;
+    logic [NB_BANKS-1:0][PORT_BITS-1:0]         winner;
+    logic [NB_BANKS-1:0]                        bank_used;
+
+    always_comb begin
+        for (int p = 0; p < NB_PORTS; p++) begin
+            word_addr[p] = {data_addr_i[p][ADDR_WIDTH-1:2], 2'b0};
+            bank[p]      = NB_BANKS > 1 ? data_addr_i[p][2 +: BANK_BITS] : '0;
+        end
+    end
+
+    always_comb begin: arbiter
+        int p;
+
+        data_gnt_o = '0;
+        winner     = '0;
+        bank_used  = '0;
+        for (int b = 0; b < NB_BANKS; b++) begin
+            for (int i = 0; i < NB_PORTS; i++) begin
+                p = (int'(rr_q[b]) + i) % NB_PORTS;
+                if (!bank_used[b] && data_req_i[p] && bank[p] == b) begin
+                    data_gnt_o[p] = 1'b1;
+                    winner[b]     = PORT_BITS'(p);
+                    bank_used[b]  = 1'b1;
+                end
+            end
+        end
+    end
+
+    // the core that just won a bank goes last next time
+    always_ff @(posedge clk_i, negedge rst_ni) begin: round_robin
+        if (~rst_ni) begin
+            rr_q           <= '0;
+            instr_rvalid_o <= '0;
+            data_rvalid_o  <= '0;
+
+        end else begin
+            for (int b = 0; b < NB_BANKS; b++)
+                if (bank_used[b])
+                    rr_q[b] <= PORT_BITS'((int'(winner[b]) + 1) % NB_PORTS);
+            instr_rvalid_o <= instr_req_i;
+            data_rvalid_o  <= data_gnt_o;
+
+        end
+    end
+
+    assign instr_gnt_o = instr_req_i;
+
+    always @(posedge clk_i) begin: banks
+        for (int p = 0; p < NB_PORTS; p++) begin
+            for (int i = 0; i < 16; i++)
+                instr_rdata_o[p][8*i +: 8] <= mem[instr_addr_i[p]
+                                                  + ADDR_WIDTH'(i)];
+
+            if (data_gnt_o[p]) begin
+                for (int i = 0; i < 4; i++) begin
+                    if (data_we_i[p]) begin
+                        if (data_be_i[p][i])
+                            mem[word_addr[p] + ADDR_WIDTH'(i)]
+                                <= data_wdata_i[p][8*i +: 8];
+                    end else
+                        data_rdata_o[p][8*i +: 8]
+                            <= mem[word_addr[p] + ADDR_WIDTH'(i)];
+                end
+            end
+        end
+    end
+
+endmodule // tcdm
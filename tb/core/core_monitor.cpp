@@ -0,0 +1,817 @@
+// Copyright 2019 ETH Zurich and University of Bologna.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Counters on the internals of the core, fed by core_monitor.sv.
+//
+// Instruction fetch: an instruction handed to the if stage either was held in
+// the prefetch buffer already (a hit, the L0 buffer with INSTR_RDATA_WIDTH=128
+// or the fetch fifo otherwise) or arrived from the instruction memory in that
+// very cycle (a miss). Refills are granted requests to the memory. A redirect
+// (jump, taken branch, exception) throws away the requests still in flight,
+// a hardware loop jumping back fetches its start again. Starved cycles are
+// cycles in which the decoder was ready but the buffer had nothing to give.
+//
+// Testbench events: the same events mm_ram drives into the external
+// performance counters of the core (CSR 0x78C to 0x78F), counted for the whole
+// run so they can be compared with what the firmware read for its regions.
+//
+// Stall attribution: every cycle goes to exactly one cause, charged to the
+// instruction in the id stage. In order: the core sleeps, is in debug mode,
+// retires the instruction, throws it away for a mispredicted branch (any taken
+// one without BRANCH_PREDICT) or is busy with a flush (csr, fence, exception,
+// interrupt); otherwise the instruction waits for a load, a jump register, the
+// apu, the multiplier or divider or the lsu.
+// If the id stage is empty the cycle belongs to the jump or flush that emptied
+// it, or else to the fetch. With +elf=path the cycles are also summed per
+// function of the firmware.
+//
+// Branch sites: every conditional branch (counted in the ex stage), jal and
+// jalr (counted when they leave id) with how often it ran, how often it was
+// taken and the jump/branch cycles above that it caused. The sites with the
+// most penalty cycles are printed, +branch_table=path writes all of them.
+// Conditional branches also count how often the fetch went the wrong way:
+// against the backward taken prediction with BRANCH_PREDICT, when taken
+// without it.
+//
+// Hardware loops: every lp.setup (or the count written by lp.count or a csr)
+// is charged to its pc with the iteration count it programmed; the jumps back
+// are counted when the first instruction of the body leaves id again. The
+// conditional branches that jump backwards and are taken most are listed as
+// the loops the compiler could have turned into hardware loops.
+//
+// Divider and multiplier: every div, divu, rem, remu and mulh* counts the
+// cycles it spends in the ex stage. The serial divider needs more cycles the
+// fewer significant bits the divisor has, so the divisions are also split by
+// the size of the divisor, the mulh* by their larger operand. The sites that
+// spent the most cycles in them are listed.
+//
+// Instruction pairs: two instructions retired one after the other where the
+// second reads what the first wrote, of the kinds a decoder could fuse
+// (lui+addi, lui+jalr, addi+jalr, slli+srli, add+lw, lui meaning auipc as
+// well), and how many of them MACRO_OP_FUSION did fuse.
+
+#include "svdpi.h"
+
+#include <elf.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// how many functions and branch sites the report lists
+#define CORE_MONITOR_TOP_FUNCTIONS 20
+#define CORE_MONITOR_TOP_BRANCHES  20
+#define CORE_MONITOR_TOP_LOOPS     10
+#define CORE_MONITOR_TOP_MULDIV    10
+
+struct fetch_stats {
+    uint64_t delivered;
+    uint64_t misses;
+    uint64_t refills;
+    uint64_t outstanding;
+    uint64_t doomed; // outstanding, but already dropped by a redirect
+    uint64_t redirects;
+    uint64_t discarded;
+    uint64_t hwlp_refetches;
+    uint64_t starved;
+};
+
+struct ext_stats {
+    uint64_t mem_wait;
+    uint64_t timer_irqs;
+    uint64_t console;
+    uint64_t dma;
+};
+
+enum stall_cause {
+    STALL_RETIRED,
+    STALL_IF,
+    STALL_LOAD_USE,
+    STALL_BRANCH,
+    STALL_MULDIV,
+    STALL_LSU,
+    STALL_APU,
+    STALL_FLUSH,
+    STALL_DEBUG,
+    STALL_SLEEP,
+    STALL_CAUSES
+};
+
+static const char *const stall_names[STALL_CAUSES] = {
+    "retired", "if starved", "load use", "jump/branch", "mul/div busy",
+    "lsu wait", "apu", "csr/fence flush", "debug", "sleep",
+};
+
+// column headings of the per function table
+static const char *const stall_short[STALL_CAUSES] = {
+    "ret", "if", "ld", "br", "mdiv", "lsu", "apu", "fl", "dbg", "slp",
+};
+
+typedef std::array<uint64_t, STALL_CAUSES> stall_counts;
+
+// jump_in_dec of the id stage
+enum { JUMP_NONE, JUMP_JAL, JUMP_JALR, JUMP_COND };
+
+static const char *const jump_names[] = {"", "jal", "jalr", "branch"};
+
+struct branch_site {
+    int kind;
+    uint32_t target;
+    uint64_t count;
+    uint64_t taken;
+    uint64_t mispredicted;
+    uint64_t penalty;
+};
+
+struct hwloop_site {
+    uint32_t start;
+    uint32_t end; // of the last instruction of the body
+    uint64_t setups;
+    uint64_t iterations; // as programmed
+    uint64_t backs;
+};
+
+// the low bits of the alu operator for div, then mulh by signed mode
+enum {
+    MD_DIVU, MD_DIV, MD_REMU, MD_REM, MD_MULHU, MD_MULHSU, MD_MULH, MD_OPS
+};
+
+static const char *const md_names[MD_OPS] = {
+    "divu", "div", "remu", "rem", "mulhu", "mulhsu", "mulh",
+};
+
+// significant bits of the operand: 1-8, 9-16, 17-24, 25-32
+#define MD_BUCKETS 4
+
+struct latency_stats {
+    uint64_t count;
+    uint64_t cycles;
+    uint32_t min, max;
+    std::map<uint32_t, uint64_t> hist;
+    uint64_t size_count[MD_BUCKETS];
+    uint64_t size_cycles[MD_BUCKETS];
+};
+
+struct muldiv_site {
+    int op;
+    uint64_t count;
+    uint64_t cycles;
+};
+
+// major opcodes of the instructions in pairs
+enum {
+    OPC_LOAD  = 0x03,
+    OPC_IMM   = 0x13,
+    OPC_AUIPC = 0x17,
+    OPC_OP    = 0x33,
+    OPC_LUI   = 0x37,
+    OPC_JALR  = 0x67,
+};
+
+enum {
+    PAIR_LUI_ADDI, PAIR_LUI_JALR, PAIR_ADDI_JALR, PAIR_SLLI_SRLI, PAIR_ADD_LW,
+    PAIR_KINDS
+};
+
+static const char *const pair_names[PAIR_KINDS] = {
+    "lui+addi", "lui+jalr", "addi+jalr", "slli+srli", "add+lw",
+};
+
+struct pair_stats {
+    uint64_t retired;
+    uint32_t last; // instruction retired before
+    uint64_t count[PAIR_KINDS];
+    uint64_t fused[PAIR_KINDS];
+};
+
+struct symbol {
+    uint32_t addr;
+    std::string name;
+};
+
+static struct core_monitor {
+    uint64_t cycles;
+    fetch_stats fetch;
+    ext_stats ext;
+    stall_counts stalls;
+    std::unordered_map<uint32_t, stall_counts> pc_stalls;
+    int refill_cause = STALL_IF; // of the cycles until id has something again
+    uint32_t refill_site;        // the jump or branch to blame for them
+    uint32_t pc_ex;
+    std::unordered_map<uint32_t, branch_site> branches;
+    std::string branch_table;
+    std::unordered_map<uint32_t, hwloop_site> hwloops; // by the setup pc
+    uint32_t hwloop_setup[2];                            // of the two loops
+    uint32_t ex_pc;     // of the instruction in the ex stage
+    uint32_t md_cycles; // it has been there so far
+    latency_stats md[MD_OPS];
+    std::unordered_map<uint32_t, muldiv_site> md_sites;
+    pair_stats pairs;
+    std::vector<symbol> symbols; // sorted by address
+} mon;
+
+static double percent(uint64_t a, uint64_t b)
+{
+    return b ? 100.0 * a / b : 0.0;
+}
+
+extern "C" void core_monitor_fetch(svBit instr_req, svBit instr_gnt,
+                                   svBit instr_rvalid, svBit delivered,
+                                   svBit starved, svBit redirect,
+                                   svBit hwlp_jump)
+{
+    fetch_stats &f = mon.fetch;
+
+    mon.cycles++;
+
+    if (delivered) {
+        f.delivered++;
+        f.misses += instr_rvalid;
+    }
+    if (redirect) {
+        f.redirects++;
+        // what comes back for them now is of no use
+        f.discarded += f.outstanding - f.doomed;
+        f.doomed = f.outstanding;
+    }
+    f.hwlp_refetches += hwlp_jump;
+    f.starved += starved;
+
+    if (instr_req && instr_gnt) {
+        f.refills++;
+        f.outstanding++;
+    }
+    if (instr_rvalid && f.outstanding) {
+        f.outstanding--;
+        if (f.doomed)
+            f.doomed--;
+    }
+}
+
+extern "C" void core_monitor_ext(svBit mem_wait, svBit timer_irq,
+                                 svBit console, svBit dma)
+{
+    ext_stats &e = mon.ext;
+
+    e.mem_wait += mem_wait;
+    e.timer_irqs += timer_irq;
+    e.console += console;
+    e.dma += dma;
+}
+
+extern "C" void core_monitor_branch(int pc_ex, int target, svBit branch_in_ex,
+                                    svBit taken, svBit predicted, int pc_id,
+                                    int jump, svBit retired)
+{
+    if (branch_in_ex) {
+        branch_site &b = mon.branches[(uint32_t)pc_ex];
+        b.kind   = JUMP_COND;
+        b.target = target;
+        b.count++;
+        b.taken += taken;
+        b.mispredicted += taken != predicted;
+    }
+    if (retired && (jump == JUMP_JAL || jump == JUMP_JALR)) {
+        branch_site &b = mon.branches[(uint32_t)pc_id];
+        b.kind = jump;
+        b.count++;
+        b.taken++;
+    }
+    mon.pc_ex = pc_ex;
+}
+
+extern "C" void core_monitor_hwloop(int pc, svBit setup, int regid, int count,
+                                    int back, int start0, int end0,
+                                    int start1, int end1)
+{
+    const uint32_t start[2] = {(uint32_t)start0, (uint32_t)start1};
+    const uint32_t end[2]   = {(uint32_t)end0, (uint32_t)end1};
+
+    if (setup) {
+        hwloop_site &h = mon.hwloops[(uint32_t)pc];
+        h.setups++;
+        h.iterations += (uint32_t)count;
+        mon.hwloop_setup[regid & 1] = pc;
+    }
+    for (int i = 0; i < 2; i++) {
+        if (!(back >> i & 1))
+            continue;
+        hwloop_site &h = mon.hwloops[mon.hwloop_setup[i]];
+        h.start = start[i];
+        h.end   = end[i];
+        h.backs++;
+    }
+}
+
+// 1 to 32, including the sign bit
+static int significant_bits(uint32_t v, bool is_signed)
+{
+    if (is_signed && (int32_t)v < 0)
+        v = ~v;
+    return v ? 32 - __builtin_clz(v) + is_signed : 1;
+}
+
+extern "C" void core_monitor_muldiv(int pc_id, svBit retired, svBit ex_ready,
+                                    svBit div, int div_op, svBit mulh,
+                                    int mulh_signed, int a, int b)
+{
+    int op = -1, bits = 0;
+
+    if (div) {
+        op   = div_op & 3;
+        bits = significant_bits(b, op & 1);
+    } else if (mulh) {
+        op   = mulh_signed == 3 ? MD_MULH : mulh_signed ? MD_MULHSU : MD_MULHU;
+        bits = std::max(significant_bits(a, mulh_signed & 1),
+                        significant_bits(b, mulh_signed >> 1 & 1));
+    }
+
+    if (op >= 0) {
+        mon.md_cycles++;
+        // done once the ex stage takes the next instruction
+        if (ex_ready) {
+            latency_stats &l = mon.md[op];
+            muldiv_site &site = mon.md_sites[mon.ex_pc];
+            int bucket = (bits - 1) / 8;
+
+            if (!l.count || mon.md_cycles < l.min)
+                l.min = mon.md_cycles;
+            l.max = std::max(l.max, mon.md_cycles);
+            l.count++;
+            l.cycles += mon.md_cycles;
+            l.hist[mon.md_cycles]++;
+            l.size_count[bucket]++;
+            l.size_cycles[bucket] += mon.md_cycles;
+            site.op = op;
+            site.count++;
+            site.cycles += mon.md_cycles;
+            mon.md_cycles = 0;
+        }
+    }
+    if (retired)
+        mon.ex_pc = pc_id;
+}
+
+// which pair first and second make, or -1
+static int pair_kind(uint32_t first, uint32_t second)
+{
+    uint32_t op1 = first & 0x7f, op2 = second & 0x7f;
+    uint32_t funct3_1 = first >> 12 & 7, funct3_2 = second >> 12 & 7;
+    uint32_t rd = first >> 7 & 31;
+    bool upper   = op1 == OPC_LUI || op1 == OPC_AUIPC;
+    bool addi1   = op1 == OPC_IMM && funct3_1 == 0;
+    bool addi2   = op2 == OPC_IMM && funct3_2 == 0;
+    bool same_rd = (second >> 7 & 31) == rd;
+
+    if (!rd || (second >> 15 & 31) != rd)
+        return -1;
+    if (upper && addi2 && same_rd)
+        return PAIR_LUI_ADDI;
+    if (upper && op2 == OPC_JALR)
+        return PAIR_LUI_JALR;
+    if (addi1 && op2 == OPC_JALR)
+        return PAIR_ADDI_JALR;
+    if (op1 == OPC_IMM && funct3_1 == 1 && op2 == OPC_IMM && funct3_2 == 5 &&
+        !(first >> 25) && !(second >> 25) && same_rd)
+        return PAIR_SLLI_SRLI;
+    if (op1 == OPC_OP && funct3_1 == 0 && !(first >> 25) && op2 == OPC_LOAD &&
+        funct3_2 == 2)
+        return PAIR_ADD_LW;
+    return -1;
+}
+
+extern "C" void core_monitor_fusion(int instr, svBit retired, svBit fused)
+{
+    pair_stats &p = mon.pairs;
+
+    if (!retired)
+        return;
+    int kind = pair_kind(p.last, (uint32_t)instr);
+    if (kind >= 0) {
+        p.count[kind]++;
+        p.fused[kind] += fused;
+    }
+    p.retired++;
+    p.last = instr;
+}
+
+extern "C" void core_monitor_branch_table(const char *path)
+{
+    mon.branch_table = path;
+}
+
+extern "C" void core_monitor_stage(int pc, svBit sleep, svBit debug,
+                                   svBit retired, svBit branch_taken,
+                                   svBit decoding, svBit instr_valid,
+                                   svBit load_use, svBit jr_stall, svBit apu,
+                                   svBit muldiv, svBit lsu, svBit redirect,
+                                   svBit redirect_branch)
+{
+    uint32_t site = (uint32_t)pc;
+    int cause;
+
+    if (sleep)
+        cause = STALL_SLEEP;
+    else if (debug)
+        cause = STALL_DEBUG;
+    else if (retired)
+        cause = STALL_RETIRED;
+    else if (branch_taken) {
+        cause = STALL_BRANCH;
+        site  = mon.pc_ex;
+    } else if (!decoding)
+        cause = STALL_FLUSH;
+    else if (!instr_valid) {
+        cause = mon.refill_cause;
+        site  = mon.refill_site;
+    } else if (load_use)
+        cause = STALL_LOAD_USE;
+    else if (jr_stall)
+        cause = STALL_BRANCH;
+    else if (apu)
+        cause = STALL_APU;
+    else if (muldiv)
+        cause = STALL_MULDIV;
+    else if (lsu)
+        cause = STALL_LSU;
+    else
+        cause = STALL_FLUSH; // halted for a fence, csr, ecall, ...
+
+    if (cause == STALL_BRANCH)
+        mon.branches[site].penalty++;
+
+    if (instr_valid)
+        mon.refill_cause = STALL_IF;
+    if (redirect) {
+        mon.refill_cause = redirect_branch ? STALL_BRANCH : STALL_FLUSH;
+        mon.refill_site  = branch_taken ? mon.pc_ex : (uint32_t)pc;
+    }
+
+    mon.stalls[cause]++;
+    mon.pc_stalls[(uint32_t)pc][cause]++;
+}
+
+extern "C" void core_monitor_elf(const char *path)
+{
+    std::ifstream f(path, std::ios::binary);
+    std::vector<char> elf((std::istreambuf_iterator<char>(f)),
+                          std::istreambuf_iterator<char>());
+    const Elf32_Ehdr *eh = (const Elf32_Ehdr *)elf.data();
+
+    if (!f || elf.size() < sizeof(Elf32_Ehdr)
+        || std::string(elf.data(), SELFMAG) != ELFMAG
+        || eh->e_ident[EI_CLASS] != ELFCLASS32
+        || eh->e_shoff + (uint64_t)eh->e_shnum * sizeof(Elf32_Shdr)
+               > elf.size()) {
+        fprintf(stderr, "core_monitor: %s is not a 32 bit elf file\n", path);
+        exit(1);
+    }
+
+    const Elf32_Shdr *sh = (const Elf32_Shdr *)(elf.data() + eh->e_shoff);
+    for (int i = 0; i < eh->e_shnum; i++) {
+        if (sh[i].sh_type != SHT_SYMTAB)
+            continue;
+        const Elf32_Shdr *strtab =
+            sh[i].sh_link < eh->e_shnum ? &sh[sh[i].sh_link] : nullptr;
+        if (!strtab
+            || (uint64_t)sh[i].sh_offset + sh[i].sh_size > elf.size()
+            || (uint64_t)strtab->sh_offset + strtab->sh_size > elf.size()
+            || strtab->sh_size == 0
+            || elf[strtab->sh_offset + strtab->sh_size - 1] != '\0') {
+            fprintf(stderr, "core_monitor: %s has a broken symbol table\n",
+                    path);
+            exit(1);
+        }
+        const char *str = elf.data() + strtab->sh_offset;
+        const Elf32_Sym *sym =
+            (const Elf32_Sym *)(elf.data() + sh[i].sh_offset);
+        int n = sh[i].sh_size / sizeof(Elf32_Sym);
+
+        // functions and the labels of assembly code
+        for (int j = 0; j < n; j++) {
+            int type = ELF32_ST_TYPE(sym[j].st_info);
+            if (sym[j].st_name >= strtab->sh_size) {
+                fprintf(stderr, "core_monitor: %s has a symbol name outside "
+                        "its string table\n", path);
+                exit(1);
+            }
+            if ((type != STT_FUNC && type != STT_NOTYPE) || !sym[j].st_name
+                || sym[j].st_shndx == SHN_UNDEF
+                || sym[j].st_shndx >= eh->e_shnum
+                || !(sh[sym[j].st_shndx].sh_flags & SHF_EXECINSTR)
+                || str[sym[j].st_name] == '$')
+                continue;
+            mon.symbols.push_back({sym[j].st_value, str + sym[j].st_name});
+        }
+    }
+
+    std::stable_sort(mon.symbols.begin(), mon.symbols.end(),
+                     [](const symbol &a, const symbol &b) {
+                         return a.addr < b.addr;
+                     });
+}
+
+// name of the function a pc belongs to
+static const std::string &function_of(uint32_t pc)
+{
+    static const std::string unknown = "??";
+    auto it = std::upper_bound(mon.symbols.begin(), mon.symbols.end(), pc,
+                               [](uint32_t pc, const symbol &s) {
+                                   return pc < s.addr;
+                               });
+
+    return it == mon.symbols.begin() ? unknown : std::prev(it)->name;
+}
+
+static void stall_report()
+{
+    uint64_t total = 0;
+
+    for (uint64_t n : mon.stalls)
+        total += n;
+    printf("stall: %llu cycles\n", (unsigned long long)total);
+    for (int i = 0; i < STALL_CAUSES; i++)
+        printf("stall: %-16s %12llu %5.1f%%\n", stall_names[i],
+               (unsigned long long)mon.stalls[i],
+               percent(mon.stalls[i], total));
+
+    if (mon.symbols.empty())
+        return;
+
+    std::unordered_map<std::string, stall_counts> funcs;
+    for (const auto &pc : mon.pc_stalls) {
+        stall_counts &c = funcs[function_of(pc.first)];
+        for (int i = 0; i < STALL_CAUSES; i++)
+            c[i] += pc.second[i];
+    }
+
+    std::vector<std::pair<uint64_t, std::string>> order;
+    for (const auto &f : funcs) {
+        uint64_t n = 0;
+        for (uint64_t c : f.second)
+            n += c;
+        order.push_back({n, f.first});
+    }
+    std::sort(order.rbegin(), order.rend());
+    if (order.size() > CORE_MONITOR_TOP_FUNCTIONS)
+        order.resize(CORE_MONITOR_TOP_FUNCTIONS);
+
+    printf("stall: %-24s %10s", "function", "cycles");
+    for (int i = 0; i < STALL_CAUSES; i++)
+        printf(" %5s", stall_short[i]);
+    printf("\n");
+    for (const auto &f : order) {
+        const stall_counts &c = funcs[f.second];
+        printf("stall: %-24.24s %10llu", f.second.c_str(),
+               (unsigned long long)f.first);
+        for (int i = 0; i < STALL_CAUSES; i++)
+            printf(" %5.1f", percent(c[i], f.first));
+        printf("\n");
+    }
+}
+
+static void branch_report()
+{
+    std::vector<std::pair<uint32_t, branch_site>> order(mon.branches.begin(),
+                                                        mon.branches.end());
+    std::sort(order.begin(), order.end(),
+              [](const std::pair<uint32_t, branch_site> &a,
+                 const std::pair<uint32_t, branch_site> &b) {
+                  if (a.second.penalty != b.second.penalty)
+                      return a.second.penalty > b.second.penalty;
+                  if (a.second.count != b.second.count)
+                      return a.second.count > b.second.count;
+                  return a.first < b.first;
+              });
+
+    uint64_t penalty = 0, cond = 0, mispredicted = 0;
+    for (const auto &b : order) {
+        penalty += b.second.penalty;
+        if (b.second.kind == JUMP_COND) {
+            cond += b.second.count;
+            mispredicted += b.second.mispredicted;
+        }
+    }
+    printf("branch: %zu sites, %llu penalty cycles\n", order.size(),
+           (unsigned long long)penalty);
+    printf("branch: %llu conditional, %llu mispredicted (%.1f%%)\n",
+           (unsigned long long)cond, (unsigned long long)mispredicted,
+           percent(mispredicted, cond));
+
+    // stdout gets the top of the table, the file all of it
+    auto print_table = [&order](FILE *f, size_t rows) {
+        fprintf(f, "branch: %8s %-6s %10s %7s %10s %8s  %s\n", "pc", "kind",
+                "count", "taken", "penalty", "per exec", "function");
+        for (size_t i = 0; i < order.size() && i < rows; i++) {
+            const branch_site &b = order[i].second;
+            fprintf(f, "branch: %08x %-6s %10llu %6.1f%% %10llu %8.2f  %s\n",
+                    order[i].first, jump_names[b.kind],
+                    (unsigned long long)b.count, percent(b.taken, b.count),
+                    (unsigned long long)b.penalty,
+                    b.count ? (double)b.penalty / b.count : 0.0,
+                    mon.symbols.empty() ? ""
+                                        : function_of(order[i].first).c_str());
+        }
+    };
+    print_table(stdout, CORE_MONITOR_TOP_BRANCHES);
+
+    if (!mon.branch_table.empty()) {
+        FILE *f = fopen(mon.branch_table.c_str(), "w");
+        if (!f) {
+            fprintf(stderr, "core_monitor: cannot open %s\n",
+                    mon.branch_table.c_str());
+            exit(1);
+        }
+        print_table(f, order.size());
+        fclose(f);
+    }
+}
+
+static void hwloop_report()
+{
+    std::vector<std::pair<uint32_t, hwloop_site>> loops(mon.hwloops.begin(),
+                                                        mon.hwloops.end());
+    uint64_t setups = 0, backs = 0;
+
+    std::sort(loops.begin(), loops.end(),
+              [](const std::pair<uint32_t, hwloop_site> &a,
+                 const std::pair<uint32_t, hwloop_site> &b) {
+                  if (a.second.backs != b.second.backs)
+                      return a.second.backs > b.second.backs;
+                  return a.first < b.first;
+              });
+    for (const auto &l : loops) {
+        setups += l.second.setups;
+        backs += l.second.backs;
+    }
+    printf("hwloop: %llu setups at %zu sites, %llu jumps back\n",
+           (unsigned long long)setups, loops.size(),
+           (unsigned long long)backs);
+    if (!loops.empty())
+        printf("hwloop: %8s %8s %10s %9s %10s %6s  %s\n", "pc", "setups",
+               "iterations", "per setup", "jumps back", "body", "function");
+    for (size_t i = 0; i < loops.size() && i < CORE_MONITOR_TOP_LOOPS; i++) {
+        const hwloop_site &h = loops[i].second;
+        printf("hwloop: %08x %8llu %10llu %9.1f %10llu %6d  %s\n",
+               loops[i].first, (unsigned long long)h.setups,
+               (unsigned long long)h.iterations,
+               h.setups ? (double)h.iterations / h.setups : 0.0,
+               (unsigned long long)h.backs,
+               h.backs ? (int)(h.end - h.start + 4) : 0,
+               mon.symbols.empty() ? "" : function_of(loops[i].first).c_str());
+    }
+
+    // loops left to the compiler: taken backwards, trips is how often the
+    // branch is taken per time it falls through
+    std::vector<std::pair<uint32_t, branch_site>> cands;
+    for (const auto &b : mon.branches)
+        if (b.second.kind == JUMP_COND && b.second.target < b.first
+            && b.second.taken > 1)
+            cands.push_back(b);
+    std::sort(cands.begin(), cands.end(),
+              [](const std::pair<uint32_t, branch_site> &a,
+                 const std::pair<uint32_t, branch_site> &b) {
+                  if (a.second.taken != b.second.taken)
+                      return a.second.taken > b.second.taken;
+                  return a.first < b.first;
+              });
+    if (cands.empty())
+        return;
+    printf("hwloop: backward branches that could be hardware loops\n");
+    printf("hwloop: %8s %10s %9s %10s %6s  %s\n", "pc", "taken", "trips",
+           "penalty", "body", "function");
+    for (size_t i = 0; i < cands.size() && i < CORE_MONITOR_TOP_LOOPS; i++) {
+        const branch_site &b = cands[i].second;
+        uint64_t exits = b.count - b.taken;
+        printf("hwloop: %08x %10llu %9.1f %10llu %6d  %s\n", cands[i].first,
+               (unsigned long long)b.taken,
+               exits ? (double)b.taken / exits : 0.0,
+               (unsigned long long)b.penalty,
+               (int)(cands[i].first - b.target + 4),
+               mon.symbols.empty() ? "" : function_of(cands[i].first).c_str());
+    }
+}
+
+static void muldiv_report()
+{
+    static const char *const bucket_names[MD_BUCKETS] = {
+        "1-8", "9-16", "17-24", "25-32",
+    };
+
+    for (int op = 0; op < MD_OPS; op++) {
+        const latency_stats &l = mon.md[op];
+
+        if (!l.count)
+            continue;
+        printf("muldiv: %-6s %10llu executed, %llu cycles, latency %u..%u, "
+               "avg %.2f\n",
+               md_names[op], (unsigned long long)l.count,
+               (unsigned long long)l.cycles, l.min, l.max,
+               (double)l.cycles / l.count);
+        printf("muldiv: %-6s latency", md_names[op]);
+        for (const auto &h : l.hist)
+            printf(" %u:%llu", h.first, (unsigned long long)h.second);
+        printf("\n");
+        printf("muldiv: %-6s %s bits", md_names[op],
+               op < MD_MULHU ? "divisor" : "operand");
+        for (int i = 0; i < MD_BUCKETS; i++)
+            if (l.size_count[i])
+                printf(" %s:%llu (avg %.1f)", bucket_names[i],
+                       (unsigned long long)l.size_count[i],
+                       (double)l.size_cycles[i] / l.size_count[i]);
+        printf("\n");
+    }
+
+    std::vector<std::pair<uint32_t, muldiv_site>> sites(mon.md_sites.begin(),
+                                                        mon.md_sites.end());
+    std::sort(sites.begin(), sites.end(),
+              [](const std::pair<uint32_t, muldiv_site> &a,
+                 const std::pair<uint32_t, muldiv_site> &b) {
+                  if (a.second.cycles != b.second.cycles)
+                      return a.second.cycles > b.second.cycles;
+                  return a.first < b.first;
+              });
+    if (sites.empty())
+        return;
+    printf("muldiv: %8s %-6s %10s %10s %8s  %s\n", "pc", "op", "count",
+           "cycles", "avg", "function");
+    for (size_t i = 0; i < sites.size() && i < CORE_MONITOR_TOP_MULDIV; i++) {
+        const muldiv_site &m = sites[i].second;
+        printf("muldiv: %08x %-6s %10llu %10llu %8.2f  %s\n", sites[i].first,
+               md_names[m.op], (unsigned long long)m.count,
+               (unsigned long long)m.cycles, (double)m.cycles / m.count,
+               mon.symbols.empty() ? "" : function_of(sites[i].first).c_str());
+    }
+}
+
+static void fusion_report()
+{
+    const pair_stats &p = mon.pairs;
+    uint64_t count = 0, fused = 0;
+
+    for (int i = 0; i < PAIR_KINDS; i++) {
+        count += p.count[i];
+        fused += p.fused[i];
+    }
+    printf("fusion: %llu pairs in %llu instructions (%.1f%%), %llu fused\n",
+           (unsigned long long)count, (unsigned long long)p.retired,
+           percent(count, p.retired), (unsigned long long)fused);
+    if (!count)
+        return;
+    printf("fusion: %-10s %10s %10s\n", "pair", "count", "fused");
+    for (int i = 0; i < PAIR_KINDS; i++)
+        printf("fusion: %-10s %10llu %10llu\n", pair_names[i],
+               (unsigned long long)p.count[i],
+               (unsigned long long)p.fused[i]);
+}
+
+extern "C" void core_monitor_report()
+{
+    const fetch_stats &f = mon.fetch;
+    const ext_stats &e = mon.ext;
+
+    if (!mon.cycles)
+        return;
+
+    printf("fetch: %llu instructions, %llu hits (%.1f%%), %llu misses\n",
+           (unsigned long long)f.delivered,
+           (unsigned long long)(f.delivered - f.misses),
+           percent(f.delivered - f.misses, f.delivered),
+           (unsigned long long)f.misses);
+    printf("fetch: %llu refills, %llu redirects dropped %llu of them, "
+           "%llu hardware loop refetches\n",
+           (unsigned long long)f.refills, (unsigned long long)f.redirects,
+           (unsigned long long)f.discarded,
+           (unsigned long long)f.hwlp_refetches);
+    printf("fetch: decoder starved %llu of %llu cycles (%.1f%%)\n",
+           (unsigned long long)f.starved, (unsigned long long)mon.cycles,
+           percent(f.starved, mon.cycles));
+    printf("ext: %llu memory wait cycles, %llu timer interrupts, "
+           "%llu console writes, %llu dma cycles\n",
+           (unsigned long long)e.mem_wait, (unsigned long long)e.timer_irqs,
+           (unsigned long long)e.console, (unsigned long long)e.dma);
+    stall_report();
+    branch_report();
+    hwloop_report();
+    muldiv_report();
+    fusion_report();
+}
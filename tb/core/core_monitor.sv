@@ -0,0 +1,199 @@
+// Copyright 2019 ETH Zurich and University of Bologna.
+// Copyright and related rights are licensed under the Solderpad Hardware
+// License, Version 0.51 (the "License"); you may not use this file except in
+// compliance with the License.  You may obtain a copy of the License at
+// http://solderpad.org/licenses/SHL-0.51. Unless required by applicable law
+// or agreed to in writing, software, hardware and materials distributed under
+// this License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+
+// Watches signals inside riscv_core, connected by hierarchical references in
+// riscv_wrapper, and hands them to core_monitor.cpp every cycle. The counters
+// are printed at the end of the simulation, per function if the firmware was
+// given with +elf=path as well.
+
+module core_monitor
+    (input logic        clk_i,
+     input logic        rst_ni,
+
+     // instruction fetch
+     input logic        instr_req_i,
+     input logic        instr_gnt_i,
+     input logic        instr_rvalid_i,
+     input logic        fetch_valid_i,    // the prefetch buffer has an instr.
+     input logic        fetch_ready_i,    // and the if stage takes it
+     input logic        if_req_i,         // the controller wants instructions
+     input logic        id_ready_i,
+     input logic        halt_if_i,
+     input logic        pc_set_i,         // jump, branch, exception, ...
+     input logic        hwlp_jump_i,      // back to the start of a hw loop
+
+     // pipeline, for the stall attribution
+     input logic [31:0] pc_id_i,
+     input logic [2:0]  pc_mux_i,
+     input logic        instr_valid_id_i,
+     input logic        id_valid_i,
+     input logic        is_decoding_i,
+     input logic        sleeping_i,       // clock gated, waiting for an irq
+     input logic        ctrl_busy_i,
+     input logic        first_fetch_i,
+     input logic        debug_mode_i,
+     input logic [31:0] pc_ex_i,
+     input logic [31:0] jump_target_ex_i,
+     input logic        branch_in_ex_i,
+     input logic        branch_taken_i,   // branch in ex kills the one in id
+     input logic        branch_pred_i,    // the branch in ex was predicted
+     input logic        pred_redirect_i,  // if fetches a predicted target
+     input logic [1:0]  jump_in_dec_i,    // jal or jalr in id
+     input logic        load_stall_i,
+     input logic        jr_stall_i,
+     input logic        misaligned_stall_i,
+     input logic        apu_stall_id_i,
+     input logic        csr_apu_stall_i,
+     input logic        apu_stall_ex_i,
+     input logic        wb_contention_i,
+     input logic        alu_ready_i,      // the divider is part of the alu
+     input logic        mult_ready_i,
+     input logic        lsu_ready_ex_i,   // waiting for the grant
+     input logic        lsu_ready_wb_i,   // waiting for the data
+
+     // hardware loops, riscv_core has two of them
+     input logic [2:0]  hwlp_we_i,        // start, end, count
+     input logic        hwlp_we_instr_i,  // from lp.* in id, not a csr
+     input logic        hwlp_regid_i,
+     input logic [31:0] hwlp_cnt_i,
+     input logic [1:0][31:0] hwlp_start_i,
+     input logic [1:0][31:0] hwlp_end_i,
+     input logic        hwlp_valid_i,     // loop start leaves id
+     input logic [1:0]  hwlp_dec_cnt_i,   // after a jump back of this loop
+
+     // divider and multiplier in the ex stage
+     input logic        ex_ready_i,
+     input logic        alu_en_ex_i,
+     input logic [6:0]  alu_operator_ex_i,
+     input logic [31:0] alu_op_a_ex_i,
+     input logic [31:0] alu_op_b_ex_i,
+     input logic        mult_en_ex_i,
+     input logic [2:0]  mult_operator_ex_i,
+     input logic [1:0]  mult_signed_ex_i,
+     input logic [31:0] mult_op_a_ex_i,
+     input logic [31:0] mult_op_b_ex_i,
+
+     // instruction pairs, and the ones MACRO_OP_FUSION fused
+     input logic [31:0] instr_id_i,       // decompressed
+     input logic        jr_fused_i,       // jalr on a lui/auipc/li in ex
+
+     // what mm_ram feeds to the external performance counters
+     input logic [3:0]  perf_events_i);
+
+    // pc_mux values of riscv_defines, the package is compiled after the tb
+    localparam logic [2:0] PC_JUMP   = 3'b010;
+    localparam logic [2:0] PC_BRANCH = 3'b011;
+    // and the div, divu, rem, remu operators of the alu and mulh*
+    localparam logic [6:0] ALU_DIVU  = 7'b0110000;
+    localparam logic [2:0] MUL_H     = 3'b110;
+
+    logic                  div_ex, mulh_ex;
+    logic                  redirect, mispredict;
+
+    import "DPI-C" function void core_monitor_fetch
+        (input bit instr_req, input bit instr_gnt, input bit instr_rvalid,
+         input bit delivered, input bit starved, input bit redirect,
+         input bit hwlp_jump);
+    import "DPI-C" function void core_monitor_ext
+        (input bit mem_wait, input bit timer_irq, input bit console,
+         input bit dma);
+    import "DPI-C" function void core_monitor_stage
+        (input int pc, input bit sleep, input bit debug, input bit retired,
+         input bit branch_taken, input bit decoding, input bit instr_valid,
+         input bit load_use, input bit jr_stall, input bit apu,
+         input bit muldiv, input bit lsu, input bit redirect,
+         input bit redirect_branch);
+    import "DPI-C" function void core_monitor_branch
+        (input int pc_ex, input int target, input bit branch_in_ex,
+         input bit taken, input bit predicted, input int pc_id, input int jump,
+         input bit retired);
+    import "DPI-C" function void core_monitor_hwloop
+        (input int pc, input bit setup, input int regid, input int count,
+         input int back, input int start0, input int end0, input int start1,
+         input int end1);
+    import "DPI-C" function void core_monitor_muldiv
+        (input int pc_id, input bit retired, input bit ex_ready,
+         input bit div, input int div_op, input bit mulh,
+         input int mulh_signed, input int a, input int b);
+    import "DPI-C" function void core_monitor_fusion
+        (input int instr, input bit retired, input bit fused);
+    import "DPI-C" function void core_monitor_elf(input string path);
+    import "DPI-C" function void core_monitor_branch_table(input string path);
+    import "DPI-C" function void core_monitor_report();
+
+    initial begin: load_symbols
+        string path;
+
+        if ($value$plusargs("elf=%s", path))
+            core_monitor_elf(path);
+        if ($value$plusargs("branch_table=%s", path))
+            core_monitor_branch_table(path);
+    end
+
+    assign div_ex  = alu_en_ex_i & alu_operator_ex_i[6:2] == ALU_DIVU[6:2];
+    assign mulh_ex = mult_en_ex_i & mult_operator_ex_i == MUL_H;
+
+    // with BRANCH_PREDICT the fetch also turns around for a predicted branch
+    // in id, and the branch in ex only kills the one in id if it went the
+    // other way
+    assign redirect   = pc_set_i | pred_redirect_i;
+    assign mispredict = branch_taken_i ^ (branch_in_ex_i & branch_pred_i);
+
+    final begin: core_monitor_stats
+        core_monitor_report();
+    end
+
+    always_ff @(posedge clk_i) begin: monitor
+        if (rst_ni) begin
+            core_monitor_fetch(instr_req_i, instr_gnt_i, instr_rvalid_i,
+                               fetch_valid_i & fetch_ready_i,
+                               if_req_i & id_ready_i & ~halt_if_i
+                               & ~fetch_valid_i & ~redirect,
+                               redirect, hwlp_jump_i);
+            core_monitor_ext(perf_events_i[0], perf_events_i[1],
+                             perf_events_i[2], perf_events_i[3]);
+            core_monitor_branch(pc_ex_i, jump_target_ex_i, branch_in_ex_i,
+                                branch_taken_i, branch_pred_i, pc_id_i,
+                                32'(jump_in_dec_i),
+                                id_valid_i & is_decoding_i);
+            core_monitor_hwloop(pc_id_i,
+                                hwlp_we_i[2] & (id_valid_i | ~hwlp_we_instr_i),
+                                32'(hwlp_regid_i), hwlp_cnt_i,
+                                hwlp_valid_i ? 32'(hwlp_dec_cnt_i) : 0,
+                                hwlp_start_i[0], hwlp_end_i[0],
+                                hwlp_start_i[1], hwlp_end_i[1]);
+            // the alu takes the divisor as operand a
+            core_monitor_muldiv(pc_id_i, id_valid_i & is_decoding_i,
+                                ex_ready_i, div_ex,
+                                32'(alu_operator_ex_i[1:0]), mulh_ex,
+                                32'(mult_signed_ex_i),
+                                div_ex ? alu_op_b_ex_i
+                                       : mult_op_a_ex_i,
+                                div_ex ? alu_op_a_ex_i
+                                       : mult_op_b_ex_i);
+            core_monitor_fusion(instr_id_i, id_valid_i & is_decoding_i,
+                                jr_fused_i);
+            core_monitor_stage(pc_id_i,
+                               sleeping_i | ~ctrl_busy_i | first_fetch_i,
+                               debug_mode_i, id_valid_i & is_decoding_i,
+                               mispredict, is_decoding_i,
+                               instr_valid_id_i, load_stall_i, jr_stall_i,
+                               apu_stall_id_i | csr_apu_stall_i
+                               | apu_stall_ex_i | wb_contention_i,
+                               ~alu_ready_i | ~mult_ready_i,
+                               misaligned_stall_i | ~lsu_ready_ex_i
+                               | ~lsu_ready_wb_i,
+                               redirect, pred_redirect_i
+                               | pc_mux_i == PC_BRANCH | pc_mux_i == PC_JUMP);
+        end
+    end
+
+endmodule // core_monitor
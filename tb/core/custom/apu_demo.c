@@ -0,0 +1,80 @@
+/* Int8 dot product with the dot4 operation of the accelerator model in
+ * apu_model.cpp against plain C. Needs the testbench built with APU_CUSTOM=1.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define N 1024
+
+/* operation numbers in apu_ops */
+#define APU_DOT4 1
+
+static int8_t a[N] __attribute__((aligned(4)));
+static int8_t b[N] __attribute__((aligned(4)));
+
+static inline uint32_t cycles(void)
+{
+    uint32_t c;
+    asm volatile("csrr %0, 0x780" : "=r"(c));
+    return c;
+}
+
+static inline int32_t apu_dot4(int32_t acc, uint32_t x, uint32_t y)
+{
+    asm volatile(".insn r 0x3b, 1, %3, %0, %1, %2"
+                 : "+r"(acc)
+                 : "r"(x), "r"(y), "i"(APU_DOT4));
+    return acc;
+}
+
+static int32_t dot_sw(void)
+{
+    int32_t acc = 0;
+    for (int i = 0; i < N; i++)
+        acc += a[i] * b[i];
+    return acc;
+}
+
+static int32_t dot_apu(void)
+{
+    const uint32_t *x = (const uint32_t *)a;
+    const uint32_t *y = (const uint32_t *)b;
+    int32_t acc = 0;
+    for (int i = 0; i < N / 4; i++)
+        acc = apu_dot4(acc, x[i], y[i]);
+    return acc;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t start, sw, apu;
+    int32_t ref, res;
+
+    for (int i = 0; i < N; i++) {
+        a[i] = i * 7 - 100;
+        b[i] = 55 - i * 3;
+    }
+
+    /* count cycles */
+    asm volatile("csrw 0x7A0, %0" ::"r"(1));
+    asm volatile("csrw 0x7A1, %0" ::"r"(1));
+
+    start = cycles();
+    ref   = dot_sw();
+    sw    = cycles() - start;
+
+    start = cycles();
+    res   = dot_apu();
+    apu   = cycles() - start;
+
+    printf("dot product of %d int8: %ld\n", N, (long)ref);
+    printf("software    %lu cycles\n", (unsigned long)sw);
+    printf("accelerator %lu cycles\n", (unsigned long)apu);
+
+    if (res != ref) {
+        printf("accelerator result %ld is wrong\n", (long)res);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,225 @@
+// Copyright 2019 ETH Zurich and University of Bologna.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Cycle approximate model of a simple memory to memory DMA engine for mm_ram.
+// It copies through port B of the ram, one access per cycle, whenever neither
+// the core's data port nor the traffic generator use it. Copies are done in
+// words if source, destination and length are word aligned, in bytes
+// otherwise.
+//
+// Registers, relative to the base address in mm_ram:
+//
+//   0x00 SRC     source address
+//   0x04 DST     destination address
+//   0x08 LEN     number of bytes to copy
+//   0x0c CTRL    write: bit 0 starts a transfer, bit 1 raises the interrupt
+//                       when it is done
+//                read:  bit 0 busy, bit 1 done (until the next start)
+//   0x10 CYCLES  duration of the last transfer
+
+#include "svdpi.h"
+
+#include <cstdint>
+#include <cstdio>
+
+#define DMA_SRC    0x00
+#define DMA_DST    0x04
+#define DMA_LEN    0x08
+#define DMA_CTRL   0x0c
+#define DMA_CYCLES 0x10
+
+#define DMA_CTRL_START  0x1
+#define DMA_CTRL_IRQ_EN 0x2
+#define DMA_STAT_BUSY   0x1
+#define DMA_STAT_DONE   0x2
+
+// words read but not yet written
+#define DMA_BUF_DEPTH 2
+
+static struct dma {
+    // registers
+    uint32_t src;
+    uint32_t dst;
+    uint32_t len;
+    uint32_t cycles;
+    bool irq_en;
+    bool busy;
+    bool done;
+    bool irq;
+
+    // transfer state
+    unsigned unit; // 4 or 1 bytes
+    uint32_t rd_off;
+    uint32_t wr_off;
+    uint64_t start;
+    bool rd_pending;
+    uint32_t buf[DMA_BUF_DEPTH];
+    unsigned buf_cnt;
+
+    // the request on the bus
+    bool req;
+    bool we;
+
+    // statistics
+    uint64_t cycle;
+    uint64_t transfers;
+    uint64_t bytes;
+    uint64_t busy_cycles;
+    uint64_t wait_cycles;
+} dma;
+
+extern "C" void dma_reg_write(int addr, int data)
+{
+    switch (addr & 0x1f) {
+    case DMA_SRC:
+        dma.src = data;
+        break;
+    case DMA_DST:
+        dma.dst = data;
+        break;
+    case DMA_LEN:
+        dma.len = data;
+        break;
+    case DMA_CTRL:
+        if (!(data & DMA_CTRL_START))
+            break;
+        if (dma.busy) {
+            fprintf(stderr, "dma: start while busy ignored\n");
+            break;
+        }
+        dma.irq_en  = data & DMA_CTRL_IRQ_EN;
+        dma.busy    = true;
+        dma.done    = false;
+        dma.unit    = (dma.src | dma.dst | dma.len) & 3 ? 1 : 4;
+        dma.rd_off  = 0;
+        dma.wr_off  = 0;
+        dma.buf_cnt = 0;
+        dma.start   = dma.cycle;
+        break;
+    default:
+        fprintf(stderr, "dma: write to unknown register %08x\n", addr);
+        break;
+    }
+}
+
+extern "C" int dma_reg_read(int addr)
+{
+    switch (addr & 0x1f) {
+    case DMA_SRC:
+        return dma.src;
+    case DMA_DST:
+        return dma.dst;
+    case DMA_LEN:
+        return dma.len;
+    case DMA_CTRL:
+        return (dma.busy ? DMA_STAT_BUSY : 0) | (dma.done ? DMA_STAT_DONE : 0);
+    case DMA_CYCLES:
+        return dma.cycles;
+    default:
+        fprintf(stderr, "dma: read from unknown register %08x\n", addr);
+        return 0;
+    }
+}
+
+// Advance by one cycle. gnt tells whether the request driven in this cycle got
+// the ram, rdata is the ram output, which holds the data of a read granted in
+// the previous cycle. The outputs are the request for the next cycle and the
+// interrupt line.
+extern "C" void dma_tick(svBit gnt, int rdata, svBit irq_ack, svBit *req,
+                         int *addr, svBit *we, int *be, int *wdata,
+                         svBit *irq)
+{
+    dma.cycle++;
+
+    if (irq_ack)
+        dma.irq = false;
+
+    if (dma.rd_pending) {
+        uint32_t data = rdata;
+        if (dma.unit == 1)
+            data = data >> ((dma.src + dma.rd_off - 1) % 4 * 8) & 0xff;
+        dma.buf[dma.buf_cnt++] = data;
+        dma.rd_pending = false;
+    }
+
+    if (dma.req && gnt) {
+        if (dma.we) {
+            for (unsigned i = 1; i < dma.buf_cnt; i++)
+                dma.buf[i - 1] = dma.buf[i];
+            dma.buf_cnt--;
+            dma.wr_off += dma.unit;
+        } else {
+            dma.rd_pending = true;
+            dma.rd_off += dma.unit;
+        }
+    } else if (dma.req) {
+        dma.wait_cycles++;
+    }
+
+    if (dma.busy && dma.wr_off >= dma.len) {
+        dma.busy   = false;
+        dma.done   = true;
+        dma.irq   |= dma.irq_en;
+        dma.cycles = dma.cycle - dma.start;
+        dma.transfers++;
+        dma.bytes       += dma.len;
+        dma.busy_cycles += dma.cycles;
+    }
+
+    // write back what we have once the buffer is full or nothing is left to
+    // read, otherwise keep reading
+    unsigned inflight = dma.buf_cnt + dma.rd_pending;
+    dma.req = false;
+    if (dma.busy) {
+        if (dma.buf_cnt
+            && (inflight == DMA_BUF_DEPTH || dma.rd_off >= dma.len)) {
+            dma.req = true;
+            dma.we  = true;
+        } else if (dma.rd_off < dma.len && inflight < DMA_BUF_DEPTH) {
+            dma.req = true;
+            dma.we  = false;
+        }
+    }
+
+    *req   = dma.req;
+    *we    = dma.we;
+    *irq   = dma.irq;
+    *wdata = 0;
+    *be    = 0xf;
+    if (dma.req && dma.we) {
+        uint32_t dst = dma.dst + dma.wr_off;
+        *addr = dst & ~3u;
+        if (dma.unit == 1) {
+            *be    = 1 << (dst % 4);
+            *wdata = dma.buf[0] << (dst % 4 * 8);
+        } else {
+            *wdata = dma.buf[0];
+        }
+    } else {
+        *addr = (dma.src + dma.rd_off) & ~3u;
+    }
+}
+
+extern "C" void dma_report()
+{
+    if (!dma.transfers)
+        return;
+
+    printf("dma: %llu transfers, %llu bytes in %llu cycles "
+           "(%.2f bytes/cycle), %llu cycles waiting for the ram\n",
+           (unsigned long long)dma.transfers, (unsigned long long)dma.bytes,
+           (unsigned long long)dma.busy_cycles,
+           dma.busy_cycles ? (double)dma.bytes / dma.busy_cycles : 0.0,
+           (unsigned long long)dma.wait_cycles);
+}
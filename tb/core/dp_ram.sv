@@ -9,8 +9,12 @@
 // CONDITIONS OF ANY KIND, either express or implied. See the License for the
 // specific language governing permissions and limitations under the License.
 
+// With SPARSE=1 the memory lives in sparse_mem.cpp and is only allocated where
+// it is written, for large ADDR_WIDTHs. It then loads +firmware by itself.
+
 module dp_ram
-    #(parameter ADDR_WIDTH = 8)
+    #(parameter ADDR_WIDTH = 8,
+      parameter SPARSE = 0)
     (input logic                  clk_i,
 
      input logic                  en_a_i,
@@ -27,51 +31,97 @@ module dp_ram
      input logic                  we_b_i,
      input logic [3:0]            be_b_i);
 
-    localparam bytes = 2**ADDR_WIDTH;
+    import "DPI-C" function chandle sparse_mem_new(input int addr_width);
+    import "DPI-C" function int sparse_mem_read(input chandle mem, input int addr);
+    import "DPI-C" function void sparse_mem_write
+        (input chandle mem, input int addr, input int data, input int be);
+    import "DPI-C" function void sparse_mem_load_hex(input chandle mem,
+                                                     input string path);
+    import "DPI-C" function void sparse_mem_report(input chandle mem);
+    import "DPI-C" function void sparse_mem_free(input chandle mem);
+
+    localparam bytes = SPARSE ? 1 : 2**ADDR_WIDTH;
 
     logic [7:0]                      mem[bytes];
+    chandle                          mem_h;
     logic [ADDR_WIDTH-1:0]           addr_b_int;
 
     always_comb addr_b_int = {addr_b_i[ADDR_WIDTH-1:2], 2'b0};
 
-    always @(posedge clk_i) begin
-        rdata_a_o[  0+: 8] <= mem[addr_a_i +  0];
-        rdata_a_o[  8+: 8] <= mem[addr_a_i +  1];
-        rdata_a_o[ 16+: 8] <= mem[addr_a_i +  2];
-        rdata_a_o[ 24+: 8] <= mem[addr_a_i +  3];
-        rdata_a_o[ 32+: 8] <= mem[addr_a_i +  4];
-        rdata_a_o[ 40+: 8] <= mem[addr_a_i +  5];
-        rdata_a_o[ 48+: 8] <= mem[addr_a_i +  6];
-        rdata_a_o[ 56+: 8] <= mem[addr_a_i +  7];
-        rdata_a_o[ 64+: 8] <= mem[addr_a_i +  8];
-        rdata_a_o[ 72+: 8] <= mem[addr_a_i +  9];
-        rdata_a_o[ 80+: 8] <= mem[addr_a_i + 10];
-        rdata_a_o[ 88+: 8] <= mem[addr_a_i + 11];
-        rdata_a_o[ 96+: 8] <= mem[addr_a_i + 12];
-        rdata_a_o[104+: 8] <= mem[addr_a_i + 13];
-        rdata_a_o[112+: 8] <= mem[addr_a_i + 14];
-        rdata_a_o[120+: 8] <= mem[addr_a_i + 15];
-
-        /* addr_b_i is the actual memory address referenced */
-        if (en_b_i) begin
-            /* handle writes */
-            if (we_b_i) begin
-                if (be_b_i[0]) mem[addr_b_int    ] <= wdata_b_i[ 0+:8];
-                if (be_b_i[1]) mem[addr_b_int + 1] <= wdata_b_i[ 8+:8];
-                if (be_b_i[2]) mem[addr_b_int + 2] <= wdata_b_i[16+:8];
-                if (be_b_i[3]) mem[addr_b_int + 3] <= wdata_b_i[24+:8];
+    if (SPARSE) begin: sparse
+        initial begin: load_prog
+            automatic string firmware;
+
+            mem_h = sparse_mem_new(ADDR_WIDTH);
+            if ($value$plusargs("firmware=%s", firmware))
+                sparse_mem_load_hex(mem_h, firmware);
+        end
+
+        final begin: sparse_mem_stats
+            sparse_mem_report(mem_h);
+            sparse_mem_free(mem_h);
+            mem_h = null;
+        end
+
+        always @(posedge clk_i) begin
+            for (int i = 0; i < 4; i++)
+                rdata_a_o[32*i +: 32] <= sparse_mem_read(mem_h,
+                                                         32'(addr_a_i) + 4*i);
+
+            if (en_b_i) begin
+                if (we_b_i)
+                    sparse_mem_write(mem_h, 32'(addr_b_int), wdata_b_i,
+                                     32'(be_b_i));
+                else begin
+                    if ($test$plusargs("verbose"))
+                        $display("read  addr=0x%08x: data=0x%08x", addr_b_int,
+                                 sparse_mem_read(mem_h, 32'(addr_b_int)));
+
+                    rdata_b_o <= sparse_mem_read(mem_h, 32'(addr_b_int));
+                end
             end
-            /* handle reads */
-            else begin
-                if ($test$plusargs("verbose"))
-                    $display("read  addr=0x%08x: data=0x%08x", addr_b_int,
-                             {mem[addr_b_int + 3], mem[addr_b_int + 2],
-                              mem[addr_b_int + 1], mem[addr_b_int + 0]});
-
-                rdata_b_o[ 7: 0] <= mem[addr_b_int    ];
-                rdata_b_o[15: 8] <= mem[addr_b_int + 1];
-                rdata_b_o[23:16] <= mem[addr_b_int + 2];
-                rdata_b_o[31:24] <= mem[addr_b_int + 3];
+        end
+
+    end else begin: flat
+        always @(posedge clk_i) begin
+            rdata_a_o[  0+: 8] <= mem[addr_a_i +  0];
+            rdata_a_o[  8+: 8] <= mem[addr_a_i +  1];
+            rdata_a_o[ 16+: 8] <= mem[addr_a_i +  2];
+            rdata_a_o[ 24+: 8] <= mem[addr_a_i +  3];
+            rdata_a_o[ 32+: 8] <= mem[addr_a_i +  4];
+            rdata_a_o[ 40+: 8] <= mem[addr_a_i +  5];
+            rdata_a_o[ 48+: 8] <= mem[addr_a_i +  6];
+            rdata_a_o[ 56+: 8] <= mem[addr_a_i +  7];
+            rdata_a_o[ 64+: 8] <= mem[addr_a_i +  8];
+            rdata_a_o[ 72+: 8] <= mem[addr_a_i +  9];
+            rdata_a_o[ 80+: 8] <= mem[addr_a_i + 10];
+            rdata_a_o[ 88+: 8] <= mem[addr_a_i + 11];
+            rdata_a_o[ 96+: 8] <= mem[addr_a_i + 12];
+            rdata_a_o[104+: 8] <= mem[addr_a_i + 13];
+            rdata_a_o[112+: 8] <= mem[addr_a_i + 14];
+            rdata_a_o[120+: 8] <= mem[addr_a_i + 15];
+
+            /* addr_b_i is the actual memory address referenced */
+            if (en_b_i) begin
+                /* handle writes */
+                if (we_b_i) begin
+                    if (be_b_i[0]) mem[addr_b_int    ] <= wdata_b_i[ 0+:8];
+                    if (be_b_i[1]) mem[addr_b_int + 1] <= wdata_b_i[ 8+:8];
+                    if (be_b_i[2]) mem[addr_b_int + 2] <= wdata_b_i[16+:8];
+                    if (be_b_i[3]) mem[addr_b_int + 3] <= wdata_b_i[24+:8];
+                end
+                /* handle reads */
+                else begin
+                    if ($test$plusargs("verbose"))
+                        $display("read  addr=0x%08x: data=0x%08x", addr_b_int,
+                                 {mem[addr_b_int + 3], mem[addr_b_int + 2],
+                                  mem[addr_b_int + 1], mem[addr_b_int + 0]});
+
+                    rdata_b_o[ 7: 0] <= mem[addr_b_int    ];
+                    rdata_b_o[15: 8] <= mem[addr_b_int + 1];
+                    rdata_b_o[23:16] <= mem[addr_b_int + 2];
+                    rdata_b_o[31:24] <= mem[addr_b_int + 3];
+                end
             end
         end
     end
@@ -80,12 +130,20 @@ module dp_ram
     export "DPI-C" task write_byte;
 
     function int read_byte(input logic [ADDR_WIDTH-1:0] byte_addr);
-        read_byte = mem[byte_addr];
+        if (SPARSE)
+            read_byte = sparse_mem_read(mem_h, 32'(byte_addr)) & 'hff;
+        else
+            read_byte = mem[byte_addr];
     endfunction
 
     task write_byte(input integer byte_addr, logic [7:0] val, output logic [7:0] other);
-        mem[byte_addr] = val;
-        other          = mem[byte_addr];
+        if (SPARSE) begin
+            sparse_mem_write(mem_h, byte_addr, 32'(val), 1);
+            other = val;
+        end else begin
+            mem[byte_addr] = val;
+            other          = mem[byte_addr];
+        end
 
     endtask
 
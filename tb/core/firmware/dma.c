@@ -0,0 +1,124 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+
+// Compare copying a buffer with the core against offloading it to the dma
+// engine of the testbench (see dma.cpp).
+
+#include "firmware.h"
+
+#define DMA_SRC    (*(volatile uint32_t *)0x16000000)
+#define DMA_DST    (*(volatile uint32_t *)0x16000004)
+#define DMA_LEN    (*(volatile uint32_t *)0x16000008)
+#define DMA_CTRL   (*(volatile uint32_t *)0x1600000c)
+#define DMA_CYCLES (*(volatile uint32_t *)0x16000010)
+
+#define DMA_CTRL_START  0x1
+#define DMA_CTRL_IRQ_EN 0x2
+#define DMA_STAT_BUSY   0x1
+
+#define BUF_WORDS 256
+
+static uint32_t src[BUF_WORDS];
+static uint32_t dst[BUF_WORDS];
+
+// incremented by the interrupt handler in start.S
+volatile uint32_t dma_irqs;
+
+static void cpu_copy(uint32_t *to, const uint32_t *from, int words)
+{
+    while (words--)
+        *to++ = *from++;
+}
+
+static void dma_start(uint32_t *to, const uint32_t *from, int words,
+                      uint32_t ctrl)
+{
+    DMA_SRC  = (uint32_t)from;
+    DMA_DST  = (uint32_t)to;
+    DMA_LEN  = words * 4;
+    DMA_CTRL = DMA_CTRL_START | ctrl;
+}
+
+static void fill(void)
+{
+    for (int i = 0; i < BUF_WORDS; i++) {
+        src[i] = (i << 16 | i) ^ 0xdeadbeef;
+        dst[i] = 0;
+    }
+}
+
+static bool check(const char *what)
+{
+    for (int i = 0; i < BUF_WORDS; i++) {
+        if (dst[i] != src[i]) {
+            print_str(what);
+            print_str(" copy is wrong at word ");
+            print_dec(i);
+            print_str("\n");
+            return false;
+        }
+    }
+    return true;
+}
+
+static void print_cycles(const char *what, uint32_t n)
+{
+    print_str(what);
+    print_dec(n);
+    print_str(" cycles\n");
+}
+
+// returns 0 on success
+int dma_bench(void)
+{
+    uint32_t start, cpu, poll, spare, irqs;
+    uint32_t before[4], after[4];
+    int err = 0;
+
+    print_str("copying ");
+    print_dec(BUF_WORDS * 4);
+    print_str(" bytes\n");
+
+    fill();
+    start = cycles();
+    cpu_copy(dst, src, BUF_WORDS);
+    cpu = cycles() - start;
+    err |= !check("cpu");
+
+    // start and busy wait for the dma
+    fill();
+    ext_counters(before);
+    start = cycles();
+    dma_start(dst, src, BUF_WORDS, 0);
+    while (DMA_CTRL & DMA_STAT_BUSY)
+        ;
+    poll = cycles() - start;
+    ext_counters(after);
+    err |= !check("dma");
+
+    // let the core do something else until the interrupt arrives
+    fill();
+    irqs  = dma_irqs;
+    spare = 0;
+    dma_start(dst, src, BUF_WORDS, DMA_CTRL_IRQ_EN);
+    while (dma_irqs == irqs)
+        spare++;
+    err |= !check("dma irq");
+
+    print_cycles("cpu copy ............. ", cpu);
+    print_cycles("dma copy (polling) ... ", poll);
+    print_cycles("dma engine busy ...... ", DMA_CYCLES);
+    print_cycles("  dma moving words ... ",
+                 after[PERF_EXT_DMA] - before[PERF_EXT_DMA]);
+    print_cycles("  core memory waits .. ",
+                 after[PERF_EXT_MEM_WAIT] - before[PERF_EXT_MEM_WAIT]);
+    print_str("core loop iterations while the dma copied: ");
+    print_dec(spare);
+    print_str("\n");
+
+    return err;
+}
@@ -31,6 +31,28 @@ uint32_t hard_mulhu(uint32_t a, uint32_t b);
 void multest(void);
 
 // stats.c
+// the testbench drives the external performance counters of the core, they
+// follow the 12 built in ones and are read from CSR 0x78C to 0x78F
+#define PERF_EXT_ID        12
+#define PERF_EXT_MEM_WAIT  0 // core request waiting for a grant
+#define PERF_EXT_TIMER_IRQ 1 // timer interrupt raised
+#define PERF_EXT_CONSOLE   2 // character written to the console
+#define PERF_EXT_DMA       3 // dma engine moved a word
 void stats(void);
+void ext_counters(uint32_t c[4]);
+
+// cycle counter of the core, inline to keep it out of the measured code
+static inline uint32_t cycles(void)
+{
+    uint32_t c;
+    __asm__ volatile("csrr %0, 0x780" : "=r"(c));
+    return c;
+}
+
+// dma.c
+int dma_bench(void);
+
+// loads.c
+int load_bench(void);
 
 #endif
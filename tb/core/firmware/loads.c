@@ -0,0 +1,121 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+
+// Memory bound kernels to compare the blocking load store unit against one
+// that keeps several loads in flight (LSU_OUTSTANDING). Run them with a slow
+// data memory, e.g. +mem_data_wait=4, to see the difference.
+
+#include "firmware.h"
+
+#define BUF_WORDS 256
+
+static uint32_t src[BUF_WORDS];
+static uint32_t dst[BUF_WORDS];
+static uint32_t next[BUF_WORDS];
+
+// four independent loads before their results are used
+static uint32_t sum(const uint32_t *p, int words)
+{
+    uint32_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+
+    for (int i = 0; i < words; i += 4) {
+        uint32_t a = p[i];
+        uint32_t b = p[i + 1];
+        uint32_t c = p[i + 2];
+        uint32_t d = p[i + 3];
+        s0 += a;
+        s1 += b;
+        s2 += c;
+        s3 += d;
+    }
+    return s0 + s1 + s2 + s3;
+}
+
+static void copy(uint32_t *to, const uint32_t *from, int words)
+{
+    for (int i = 0; i < words; i += 4) {
+        uint32_t a = from[i];
+        uint32_t b = from[i + 1];
+        uint32_t c = from[i + 2];
+        uint32_t d = from[i + 3];
+        to[i]     = a;
+        to[i + 1] = b;
+        to[i + 2] = c;
+        to[i + 3] = d;
+    }
+}
+
+// every load needs the one before, nothing to overlap
+static uint32_t chase(const uint32_t *list, int steps)
+{
+    uint32_t i = 0;
+
+    while (steps--)
+        i = list[i];
+    return i;
+}
+
+static void print_cycles(const char *what, uint32_t n)
+{
+    print_str(what);
+    print_dec(n);
+    print_str(" cycles\n");
+}
+
+// returns 0 on success
+int load_bench(void)
+{
+    uint32_t start, t_sum, t_copy, t_chase;
+    uint32_t expect = 0, s, last;
+    int err = 0;
+
+    for (int i = 0; i < BUF_WORDS; i++) {
+        src[i]  = (i << 16 | i) ^ 0xdeadbeef;
+        dst[i]  = 0;
+        next[i] = (i * 37 + 11) % BUF_WORDS;
+        expect += src[i];
+    }
+
+    start = cycles();
+    s = sum(src, BUF_WORDS);
+    t_sum = cycles() - start;
+    if (s != expect) {
+        print_str("load sum is wrong\n");
+        err = 1;
+    }
+
+    start = cycles();
+    copy(dst, src, BUF_WORDS);
+    t_copy = cycles() - start;
+    for (int i = 0; i < BUF_WORDS; i++) {
+        if (dst[i] != src[i]) {
+            print_str("load copy is wrong at word ");
+            print_dec(i);
+            print_str("\n");
+            err = 1;
+            break;
+        }
+    }
+
+    // walk the list by hand to know where it has to end
+    last = 0;
+    for (int i = 0; i < BUF_WORDS; i++)
+        last = (last * 37 + 11) % BUF_WORDS;
+    start = cycles();
+    s = chase(next, BUF_WORDS);
+    t_chase = cycles() - start;
+    if (s != last) {
+        print_str("load chase is wrong\n");
+        err = 1;
+    }
+
+    print_cycles("load sum ............. ", t_sum);
+    print_cycles("load copy ............ ", t_copy);
+    print_cycles("load chase ........... ", t_chase);
+
+    return err;
+}
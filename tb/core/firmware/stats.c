@@ -28,21 +28,32 @@ static void stats_print_dec(unsigned int val, int digits, bool zero_pad)
 
 void init_stats(void)
 {
-    /* enable INSTR anc CYCLE counter */
-    /* TODO: this is still buggy */
+    /* enable INSTR and CYCLE counter and the testbench events */
+    unsigned int events = 3 | 0xf << PERF_EXT_ID;
     unsigned int mask = 3;
+    __asm__ volatile("csrw 0x7A0, %0" ::"r"(events));
     __asm__ volatile("csrw 0x7A1, %0" ::"r"(mask));
 }
 
+void ext_counters(uint32_t c[4])
+{
+    __asm__ volatile("csrr %0, 0x78C" : "=r"(c[PERF_EXT_MEM_WAIT]));
+    __asm__ volatile("csrr %0, 0x78D" : "=r"(c[PERF_EXT_TIMER_IRQ]));
+    __asm__ volatile("csrr %0, 0x78E" : "=r"(c[PERF_EXT_CONSOLE]));
+    __asm__ volatile("csrr %0, 0x78F" : "=r"(c[PERF_EXT_DMA]));
+}
+
 void stats(void)
 {
     unsigned int num_cycles, num_instr;
+    uint32_t ext[4];
     /* ideally we could use this */
     // __asm__ volatile ("rdcycle %0; rdinstret %1;" : "=r"(num_cycles),
     // "=r"(num_instr));
     /* riscy specific */
     __asm__ volatile("csrr %0, 0x780" : "=r"(num_cycles));
     __asm__ volatile("csrr %0, 0x781" : "=r"(num_instr));
+    ext_counters(ext);
     print_str("Cycle counter ........");
     stats_print_dec(num_cycles, 8, false);
     print_str("\nInstruction counter ..");
@@ -51,5 +62,13 @@ void stats(void)
     stats_print_dec((num_cycles / num_instr), 0, false);
     print_str(".");
     stats_print_dec(((100 * num_cycles) / num_instr) % 100, 2, true);
+    print_str("\nMemory wait cycles ...");
+    stats_print_dec(ext[PERF_EXT_MEM_WAIT], 8, false);
+    print_str("\nTimer interrupts .....");
+    stats_print_dec(ext[PERF_EXT_TIMER_IRQ], 8, false);
+    print_str("\nConsole writes .......");
+    stats_print_dec(ext[PERF_EXT_CONSOLE], 8, false);
+    print_str("\nDMA cycles ...........");
+    stats_print_dec(ext[PERF_EXT_DMA], 8, false);
     print_str("\n");
 }
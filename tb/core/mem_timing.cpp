@@ -0,0 +1,406 @@
+// Copyright 2019 ETH Zurich and University of Bologna.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Timing model for the instruction and data ports of mm_ram. mm_ram still
+// moves the data, this model only decides when a request is granted and when
+// its response comes back. It is called once per cycle through DPI.
+//
+// It also drives a synthetic second bus master which competes with the core's
+// data port for port B of the ram, like a DMA or another core would.
+//
+// Configuration is line based, either from the file given with
+// +mem_cfg=<file> or from plusargs (see mm_ram.sv). Every line is one of
+//
+//   <port> wait <cycles>                 default wait states
+//   <port> stall <percent>               chance to refuse a grant each cycle
+//   <port> outstanding <n>               max requests granted but not answered
+//   <port> bandwidth <requests> <cycles> at most that many grants per window
+//   region <base> <size> <instr wait> <data wait>
+//                                        wait states for an address range
+//   seed <n>                             seed for the random generators
+//
+//   traffic load <percent>               chance to start a burst each idle cycle
+//   traffic burst <n>                    requests per burst
+//   traffic write <percent>              share of writes
+//   traffic region <base> <size>         address range the traffic walks through
+//   traffic stride <bytes>               address increment, 0 for random
+//   traffic policy core|traffic|rr       who wins when both want the port
+//
+// where <port> is instr, data or both. Numbers are in C notation, # starts a
+// comment. The traffic only writes to memory when a region was given.
+// Without any configuration the model behaves like the plain mm_ram: grant in
+// the same cycle, response in the next one.
+
+#include "svdpi.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// depth of the response fifos in mm_ram
+#define MEM_TIMING_MAX_OUTSTANDING 16
+
+struct mem_region {
+    uint32_t base;
+    uint32_t size;
+    unsigned wait[2];
+};
+
+struct mem_port {
+    mem_port(const char *name) : name(name) {}
+
+    const char *name;
+
+    // configuration
+    unsigned wait        = 0;
+    unsigned stall       = 0; // percent
+    unsigned outstanding = MEM_TIMING_MAX_OUTSTANDING;
+    unsigned bw_requests = 0; // 0 means unlimited
+    unsigned bw_cycles   = 1;
+
+    // state
+    std::deque<uint64_t> responses; // cycles in which the rvalids are due
+    uint64_t last_response = 0;
+    uint64_t credit        = 0;
+
+    // statistics
+    uint64_t requests     = 0;
+    uint64_t wait_cycles  = 0; // req without gnt
+    uint64_t latency      = 0; // sum from grant to rvalid
+    uint64_t max_inflight = 0;
+};
+
+enum traffic_policy { PRIO_CORE, PRIO_TRAFFIC, ROUND_ROBIN };
+
+struct mem_traffic {
+    // configuration
+    unsigned load    = 0; // percent
+    unsigned burst   = 1;
+    unsigned write   = 0; // percent
+    uint32_t base    = 0;
+    uint32_t size    = 0x10000;
+    uint32_t stride  = 4;
+    bool has_region  = false;
+    traffic_policy policy = ROUND_ROBIN;
+
+    // the request we currently drive
+    bool req       = false;
+    bool we        = false;
+    uint32_t addr  = 0;
+    uint32_t wdata = 0;
+    unsigned left  = 0;
+    uint32_t next  = 0; // offset of the next sequential access
+    bool core_turn = true;
+
+    // statistics
+    uint64_t requests    = 0;
+    uint64_t contested   = 0; // both wanted the port
+    uint64_t core_lost   = 0; // ... and the traffic got it
+};
+
+static struct mem_timing {
+    mem_port port[2] = {mem_port("instr"), mem_port("data")};
+    mem_traffic traffic;
+    std::vector<mem_region> regions;
+    uint64_t cycle  = 0;
+    uint32_t rng    = 0x2545f491;
+    bool configured = false;
+} mt;
+
+enum { INSTR = 0, DATA = 1 };
+
+static uint32_t mem_timing_rand()
+{
+    // xorshift32
+    mt.rng ^= mt.rng << 13;
+    mt.rng ^= mt.rng >> 17;
+    mt.rng ^= mt.rng << 5;
+    return mt.rng;
+}
+
+static unsigned mem_timing_wait(int p, uint32_t addr)
+{
+    for (const mem_region &r : mt.regions)
+        if (addr - r.base < r.size)
+            return r.wait[p];
+    return mt.port[p].wait;
+}
+
+static void mem_timing_error(const std::string &line, const char *what)
+{
+    fprintf(stderr, "mem_timing: %s: %s\n", what, line.c_str());
+    exit(1);
+}
+
+extern "C" void mem_timing_config(const char *cfg)
+{
+    std::string line(cfg);
+    std::istringstream in(line.substr(0, line.find('#')));
+    std::string key, opt, tok;
+    std::vector<unsigned long> val;
+
+    if (!(in >> key))
+        return;
+    if (key == "instr" || key == "data" || key == "both" || key == "traffic")
+        in >> opt;
+
+    if (key == "traffic" && opt == "policy") {
+        std::string policy;
+        in >> policy;
+        if (policy == "core")
+            mt.traffic.policy = PRIO_CORE;
+        else if (policy == "traffic")
+            mt.traffic.policy = PRIO_TRAFFIC;
+        else if (policy == "rr")
+            mt.traffic.policy = ROUND_ROBIN;
+        else
+            mem_timing_error(line, "policy is core, traffic or rr");
+        mt.configured = true;
+        return;
+    }
+
+    while (in >> tok) {
+        char *end;
+        val.push_back(strtoul(tok.c_str(), &end, 0));
+        if (*end)
+            mem_timing_error(line, "not a number");
+    }
+
+    if (key == "seed") {
+        if (val.size() != 1)
+            mem_timing_error(line, "expected seed <n>");
+        mt.rng = val[0] ? val[0] : 1;
+
+    } else if (key == "region") {
+        if (val.size() != 4)
+            mem_timing_error(line, "expected region <base> <size> <instr "
+                                   "wait> <data wait>");
+        mt.regions.push_back(
+            {(uint32_t)val[0], (uint32_t)val[1], {(unsigned)val[2],
+                                                  (unsigned)val[3]}});
+
+    } else if (key == "instr" || key == "data" || key == "both") {
+        for (int p = INSTR; p <= DATA; p++) {
+            if (key != "both" && key != mt.port[p].name)
+                continue;
+            mem_port &port = mt.port[p];
+
+            if (opt == "bandwidth") {
+                if (val.size() != 2 || !val[0] || !val[1])
+                    mem_timing_error(line, "expected <port> bandwidth "
+                                           "<requests> <cycles>");
+                port.bw_requests = val[0];
+                port.bw_cycles   = val[1];
+                port.credit      = val[0] * val[1];
+                continue;
+            }
+
+            if (val.size() != 1)
+                mem_timing_error(line, "expected <port> <option> <value>");
+            if (opt == "wait") {
+                port.wait = val[0];
+            } else if (opt == "stall") {
+                if (val[0] > 100)
+                    mem_timing_error(line, "stall is a percentage");
+                port.stall = val[0];
+            } else if (opt == "outstanding") {
+                if (!val[0] || val[0] > MEM_TIMING_MAX_OUTSTANDING)
+                    mem_timing_error(line, "outstanding must be in 1..16");
+                port.outstanding = val[0];
+            } else {
+                mem_timing_error(line, "unknown option");
+            }
+        }
+
+    } else if (key == "traffic") {
+        mem_traffic &tr = mt.traffic;
+
+        if (opt == "region") {
+            if (val.size() != 2 || val[1] < 4)
+                mem_timing_error(line, "expected traffic region <base> <size>");
+            tr.base       = val[0] & ~3u;
+            tr.size       = val[1] & ~3u;
+            tr.has_region = true;
+        } else if (val.size() != 1) {
+            mem_timing_error(line, "expected traffic <option> <value>");
+        } else if (opt == "load") {
+            if (val[0] > 100)
+                mem_timing_error(line, "load is a percentage");
+            tr.load = val[0];
+        } else if (opt == "burst") {
+            if (!val[0])
+                mem_timing_error(line, "burst must be positive");
+            tr.burst = val[0];
+        } else if (opt == "write") {
+            if (val[0] > 100)
+                mem_timing_error(line, "write is a percentage");
+            tr.write = val[0];
+        } else if (opt == "stride") {
+            tr.stride = val[0] & ~3u;
+        } else {
+            mem_timing_error(line, "unknown option");
+        }
+
+    } else {
+        mem_timing_error(line, "unknown setting");
+    }
+
+    mt.configured = true;
+}
+
+extern "C" void mem_timing_config_file(const char *path)
+{
+    std::ifstream in(path);
+    std::string line;
+
+    if (!in) {
+        fprintf(stderr, "mem_timing: failed to open %s\n", path);
+        exit(1);
+    }
+    while (std::getline(in, line))
+        mem_timing_config(line.c_str());
+}
+
+// Account for what happened in this cycle on one port and decide about the
+// next one.
+static void mem_timing_port(int p, svBit req, svBit gnt, uint32_t addr,
+                            svBit *ready, svBit *rvalid)
+{
+    mem_port &port = mt.port[p];
+
+    if (req && !gnt)
+        port.wait_cycles++;
+
+    if (req && gnt) {
+        // responses are in order and there is at most one per cycle
+        uint64_t due = mt.cycle + 1 + mem_timing_wait(p, addr);
+        if (due <= port.last_response)
+            due = port.last_response + 1;
+        port.last_response = due;
+        port.responses.push_back(due);
+        port.requests++;
+        port.latency += due - mt.cycle;
+        if (port.responses.size() > port.max_inflight)
+            port.max_inflight = port.responses.size();
+        if (port.bw_requests)
+            port.credit -= port.bw_cycles;
+    }
+
+    *rvalid = !port.responses.empty() && port.responses.front() == mt.cycle + 1;
+    if (*rvalid)
+        port.responses.pop_front();
+
+    if (port.bw_requests) {
+        port.credit += port.bw_requests;
+        if (port.credit > (uint64_t)port.bw_requests * port.bw_cycles)
+            port.credit = (uint64_t)port.bw_requests * port.bw_cycles;
+    }
+
+    *ready = port.responses.size() < port.outstanding
+             && (!port.bw_requests || port.credit >= port.bw_cycles)
+             && !(port.stall && mem_timing_rand() % 100 < port.stall);
+}
+
+extern "C" void mem_timing_tick(svBit instr_req, svBit instr_gnt,
+                                int instr_addr, svBit data_req, svBit data_gnt,
+                                int data_addr, svBit *instr_ready,
+                                svBit *instr_rvalid, svBit *data_ready,
+                                svBit *data_rvalid)
+{
+    mem_timing_port(INSTR, instr_req, instr_gnt, instr_addr, instr_ready,
+                    instr_rvalid);
+    mem_timing_port(DATA, data_req, data_gnt, data_addr, data_ready,
+                    data_rvalid);
+    mt.cycle++;
+}
+
+// Advance the traffic generator by a cycle. core_req tells whether the core's
+// data port wanted ram port B in this cycle (and wasn't held back by the model
+// itself), gnt whether the traffic got it. The outputs are the request for the
+// next cycle and whether it wins against the core.
+extern "C" void mem_traffic_tick(svBit core_req, svBit gnt, svBit *req,
+                                 svBit *prio, int *addr, svBit *we,
+                                 int *wdata)
+{
+    mem_traffic &tr = mt.traffic;
+
+    if (tr.req && core_req) {
+        tr.contested++;
+        if (gnt)
+            tr.core_lost++;
+        tr.core_turn = gnt;
+    }
+
+    bool advance = false;
+    if (tr.req && gnt) {
+        tr.requests++;
+        tr.req  = --tr.left > 0;
+        advance = tr.req;
+    } else if (!tr.req && tr.load && mem_timing_rand() % 100 < tr.load) {
+        tr.req  = true;
+        tr.left = tr.burst;
+        advance = true;
+    }
+
+    if (advance) {
+        // set up the next access of the burst
+        if (tr.stride) {
+            tr.addr = tr.base + tr.next;
+            tr.next = (tr.next + tr.stride) % tr.size;
+        } else {
+            tr.addr = tr.base + (mem_timing_rand() % tr.size & ~3u);
+        }
+        tr.we    = tr.has_region && mem_timing_rand() % 100 < tr.write;
+        tr.wdata = mem_timing_rand();
+    }
+
+    *req   = tr.req;
+    *prio  = tr.policy == PRIO_TRAFFIC
+            || (tr.policy == ROUND_ROBIN && !tr.core_turn);
+    *addr  = tr.addr;
+    *we    = tr.we;
+    *wdata = tr.wdata;
+}
+
+extern "C" void mem_timing_report()
+{
+    if (!mt.configured)
+        return;
+
+    printf("mem_timing: %llu cycles\n", (unsigned long long)mt.cycle);
+
+    for (const mem_port &port : mt.port) {
+        printf("mem_timing: %-5s %llu requests, %.2f cycles avg latency, "
+               "%llu cycles waiting for grant, %llu max outstanding\n",
+               port.name, (unsigned long long)port.requests,
+               port.requests ? (double)port.latency / port.requests : 0.0,
+               (unsigned long long)port.wait_cycles,
+               (unsigned long long)port.max_inflight);
+    }
+
+    const mem_traffic &tr = mt.traffic;
+    if (tr.load)
+        printf("mem_timing: traffic %llu requests (%.1f%% of cycles), "
+               "%llu contested cycles, %llu of them lost by the core\n",
+               (unsigned long long)tr.requests,
+               mt.cycle ? 100.0 * tr.requests / mt.cycle : 0.0,
+               (unsigned long long)tr.contested,
+               (unsigned long long)tr.core_lost);
+}
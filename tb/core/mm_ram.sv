@@ -13,10 +13,13 @@
 //              Robert Balas <balasr@student.ethz.ch>
 //
 // This maps the dp_ram module to the instruction and data ports of the RI5CY
-// processor core and some pseudo peripherals
+// processor core and some pseudo peripherals. When requests are granted and
+// answered is up to the memory timing model in mem_timing.cpp, the dma engine
+// is modelled in dma.cpp.
 
 module mm_ram
-    #(parameter RAM_ADDR_WIDTH = 16)
+    #(parameter RAM_ADDR_WIDTH = 16,
+      parameter SPARSE_MEM = 0)
     (input logic                      clk_i,
      input logic                      rst_ni,
 
@@ -43,15 +46,45 @@ module mm_ram
      output logic                     tests_passed_o,
      output logic                     tests_failed_o,
      output logic                     exit_valid_o,
-     output logic [31:0]              exit_value_o);
+     output logic [31:0]              exit_value_o,
+
+     // one bit per event for the external performance counters of the core:
+     // memory wait, timer interrupt raised, console write, dma transfer
+     output logic [3:0]               perf_events_o);
 
     localparam int                    TIMER_IRQ_ID = 3;
+    localparam int                    DMA_IRQ_ID = 4;
+    localparam logic [31:0]           DMA_BASE = 32'h1600_0000;
+    // must match MEM_TIMING_MAX_OUTSTANDING in mem_timing.cpp
+    localparam int                    RESP_FIFO_DEPTH = 16;
+
+    import "DPI-C" function void mem_timing_config(input string line);
+    import "DPI-C" function void mem_timing_config_file(input string path);
+    import "DPI-C" function void mem_timing_tick
+        (input bit instr_req, input bit instr_gnt, input int instr_addr,
+         input bit data_req, input bit data_gnt, input int data_addr,
+         output bit instr_ready, output bit instr_rvalid,
+         output bit data_ready, output bit data_rvalid);
+    import "DPI-C" function void mem_traffic_tick
+        (input bit core_req, input bit gnt,
+         output bit req, output bit prio, output int addr,
+         output bit we, output int wdata);
+    import "DPI-C" function void mem_timing_report();
+
+    import "DPI-C" function void dma_reg_write(input int addr, input int data);
+    import "DPI-C" function int dma_reg_read(input int addr);
+    import "DPI-C" function void dma_tick
+        (input bit gnt, input int rdata, input bit irq_ack,
+         output bit req, output int addr, output bit we, output int be,
+         output int wdata, output bit irq);
+    import "DPI-C" function void dma_report();
 
     // mux for read and writes
     enum logic [1:0]{RAM, MM, ERR} select_rdata_d, select_rdata_q;
     logic [31:0]                   data_addr_aligned;
 
     // signals to ram
+    logic [127:0]                  ram_instr_rdata;
     logic                          ram_data_req;
     logic [RAM_ADDR_WIDTH-1:0]     ram_data_addr;
     logic [31:0]                   ram_data_wdata;
@@ -71,10 +104,52 @@ module mm_ram
     logic                          timer_val_valid;
     logic [31:0]                   timer_wdata;
 
+    // signals to the memory timing model
+    bit                            instr_ready, instr_rvalid;
+    bit                            data_ready, data_rvalid;
+    logic                          instr_ready_q, data_ready_q;
+    logic                          data_req_gnt;
+    logic [31:0]                   data_rdata;
+
+    // signals to the synthetic bus master competing for ram port B
+    bit                            traffic_req, traffic_prio, traffic_we;
+    int                            traffic_addr, traffic_wdata;
+    logic                          traffic_req_q, traffic_prio_q;
+    logic                          traffic_we_q;
+    logic [31:0]                   traffic_addr_q, traffic_wdata_q;
+    logic                          traffic_gnt;
+    logic                          data_wants_ram;
+
+    // signals to the dma engine
+    logic                          dma_reg_valid;
+    logic [31:0]                   dma_rdata_q;
+    bit                            dma_req, dma_we, dma_irq;
+    int                            dma_addr, dma_be, dma_wdata;
+    logic                          dma_req_q, dma_we_q, dma_irq_q;
+    logic [31:0]                   dma_addr_q, dma_wdata_q;
+    logic [3:0]                    dma_be_q;
+    logic                          dma_gnt;
+
+    // The ram answers a request in the cycle after the grant, but the timing
+    // model may want to hand out the response later. Until then it waits in
+    // these fifos.
+    localparam int                 PTR_WIDTH = $clog2(RESP_FIFO_DEPTH);
+    logic                          instr_pending_q, data_pending_q;
+    logic [127:0]                  instr_fifo_q[RESP_FIFO_DEPTH];
+    logic [31:0]                   data_fifo_q[RESP_FIFO_DEPTH];
+    logic [PTR_WIDTH-1:0]          instr_wptr_q, instr_rptr_q;
+    logic [PTR_WIDTH-1:0]          data_wptr_q, data_rptr_q;
+    logic [PTR_WIDTH:0]            instr_cnt_q, data_cnt_q;
+    logic                          instr_push, instr_pop;
+    logic                          data_push, data_pop;
+
 
     // uhh, align?
     always_comb data_addr_aligned = {data_addr_i[31:2], 2'b0};
 
+    // only granted requests have side effects
+    assign data_req_gnt = data_req_i & data_gnt_o;
+
     // handle the mapping of read and writes to either memory or pseudo
     // peripherals (currently just a redirection of writes to stdout)
     always_comb begin
@@ -92,10 +167,11 @@ module mm_ram
         timer_wdata     = '0;
         timer_reg_valid = '0;
         timer_val_valid = '0;
+        dma_reg_valid   = '0;
 
         select_rdata_d  = RAM;
 
-        if (data_req_i) begin
+        if (data_req_gnt) begin
             if (data_we_i) begin // handle writes
                 if (data_addr_i < 2 ** RAM_ADDR_WIDTH) begin
                     ram_data_req = data_req_i;
@@ -126,6 +202,9 @@ module mm_ram
                     timer_wdata = data_wdata_i;
                     timer_val_valid = '1;
 
+                end else if (data_addr_i[31:5] == DMA_BASE[31:5]) begin
+                    dma_reg_valid = '1;
+
                 end else begin
                     // out of bounds write
                 end
@@ -140,11 +219,31 @@ module mm_ram
                     ram_data_we = data_we_i;
                     ram_data_be = data_be_i;
 
+                end else if (data_addr_i[31:5] == DMA_BASE[31:5]) begin
+                    select_rdata_d = MM;
+                    dma_reg_valid = '1;
+
                 end else
                     select_rdata_d = ERR;
 
             end
         end
+
+        // the core's data port lost arbitration, the traffic owns port B. Its
+        // read data is dropped.
+        if (traffic_gnt) begin
+            ram_data_req   = 1'b1;
+            ram_data_addr  = traffic_addr_q[RAM_ADDR_WIDTH-1:0];
+            ram_data_wdata = traffic_wdata_q;
+            ram_data_we    = traffic_we_q;
+            ram_data_be    = 4'b1111;
+        end else if (dma_gnt) begin
+            ram_data_req   = 1'b1;
+            ram_data_addr  = dma_addr_q[RAM_ADDR_WIDTH-1:0];
+            ram_data_wdata = dma_wdata_q;
+            ram_data_we    = dma_we_q;
+            ram_data_be    = dma_be_q;
+        end
     end
 
 `ifndef VERILATOR
@@ -156,17 +255,20 @@ module mm_ram
       || data_addr_i == 32'h1500_0000
       || data_addr_i == 32'h1500_0004
       || data_addr_i == 32'h2000_0000
-      || data_addr_i == 32'h2000_0004))
+      || data_addr_i == 32'h2000_0004
+      || data_addr_i[31:5] == DMA_BASE[31:5]))
         else $error("out of bounds write to %08x with %08x",
                     data_addr_i, data_wdata_i);
 `endif
 
     // make sure we select the proper read data
     always_comb begin: read_mux
-        data_rdata_o = '0;
+        data_rdata = '0;
 
         if(select_rdata_q == RAM) begin
-            data_rdata_o = ram_data_rdata;
+            data_rdata = ram_data_rdata;
+        end else if (select_rdata_q == MM) begin
+            data_rdata = dma_rdata_q;
         end else if (select_rdata_q == ERR) begin
             $display("out of bounds read from %08x", data_addr_i);
             $finish;
@@ -191,8 +293,19 @@ module mm_ram
         end
     end
 
-    assign irq_id_o = TIMER_IRQ_ID;
-    assign irq_o = irq_q;
+    // the timer wins if both want to interrupt
+    assign irq_id_o = irq_q ? TIMER_IRQ_ID : DMA_IRQ_ID;
+    assign irq_o = irq_q | dma_irq_q;
+
+    // events for the external performance counters, the timer raises its
+    // interrupt in the same cycle the tb_timer block below sets irq_q
+    assign perf_events_o[0] = (instr_req_i & ~instr_gnt_o)
+                              | (data_req_i & ~data_gnt_o);
+    assign perf_events_o[1] = ~timer_reg_valid & ~timer_val_valid
+                              & timer_cnt_q == 1
+                              & timer_irq_mask_q[TIMER_IRQ_ID];
+    assign perf_events_o[2] = print_valid;
+    assign perf_events_o[3] = dma_gnt;
 
     // Control timer. We need one to have some kind of timeout for tests that
     // get stuck in some loop. The riscv-tests also mandate that. Enable timer
@@ -230,14 +343,15 @@ module mm_ram
 
     // show writes if requested
     always_ff @(posedge clk_i, negedge rst_ni) begin: verbose_writes
-        if ($test$plusargs("verbose") && data_req_i && data_we_i)
+        if ($test$plusargs("verbose") && data_req_gnt && data_we_i)
             $display("write addr=0x%08x: data=0x%08x",
                      data_addr_i, data_wdata_i);
     end
 
     // instantiate the ram
     dp_ram
-        #(.ADDR_WIDTH (RAM_ADDR_WIDTH))
+        #(.ADDR_WIDTH (RAM_ADDR_WIDTH),
+          .SPARSE (SPARSE_MEM))
     dp_ram_i
         (
          .clk_i     ( clk_i         ),
@@ -245,7 +359,7 @@ module mm_ram
          .en_a_i    ( instr_req_i   ),
          .addr_a_i  ( instr_addr_i  ),
          .wdata_a_i ( '0            ),	// Not writing so ignored
-         .rdata_a_o ( instr_rdata_o ),
+         .rdata_a_o ( ram_instr_rdata ),
          .we_a_i    ( '0            ),
          .be_a_i    ( 4'b1111       ),	// Always want 32-bits
 
@@ -256,23 +370,169 @@ module mm_ram
          .we_b_i    ( ram_data_we     ),
          .be_b_i    ( ram_data_be     ));
 
-    // do the handshacking stuff by assuming we always react in one cycle
-    assign data_gnt_o  = data_req_i;
-    assign instr_gnt_o = instr_req_i;
+    // configure the memory timing model, see mem_timing.cpp for the format
+    initial begin: mem_timing_cfg
+        automatic string cfg;
+        automatic int    val;
+
+        if ($value$plusargs("mem_cfg=%s", cfg))
+            mem_timing_config_file(cfg);
+        if ($value$plusargs("mem_instr_wait=%d", val))
+            mem_timing_config($sformatf("instr wait %0d", val));
+        if ($value$plusargs("mem_data_wait=%d", val))
+            mem_timing_config($sformatf("data wait %0d", val));
+        if ($value$plusargs("mem_instr_stall=%d", val))
+            mem_timing_config($sformatf("instr stall %0d", val));
+        if ($value$plusargs("mem_data_stall=%d", val))
+            mem_timing_config($sformatf("data stall %0d", val));
+        if ($value$plusargs("mem_instr_outstanding=%d", val))
+            mem_timing_config($sformatf("instr outstanding %0d", val));
+        if ($value$plusargs("mem_data_outstanding=%d", val))
+            mem_timing_config($sformatf("data outstanding %0d", val));
+        if ($value$plusargs("mem_seed=%d", val))
+            mem_timing_config($sformatf("seed %0d", val));
+        if ($value$plusargs("mem_traffic_load=%d", val))
+            mem_timing_config($sformatf("traffic load %0d", val));
+        if ($value$plusargs("mem_traffic_burst=%d", val))
+            mem_timing_config($sformatf("traffic burst %0d", val));
+        if ($value$plusargs("mem_traffic_policy=%s", cfg))
+            mem_timing_config({"traffic policy ", cfg});
+    end
+
+    final begin: mem_timing_stats
+        mem_timing_report();
+        dma_report();
+    end
+
+    // do the handshacking stuff as the timing model tells us, the traffic
+    // master only competes with core accesses to the ram
+    assign data_wants_ram = data_req_i & data_ready_q
+                            & (data_addr_i < 2 ** RAM_ADDR_WIDTH);
+    assign traffic_gnt = traffic_req_q & (traffic_prio_q | ~data_wants_ram);
+    assign data_gnt_o  = data_req_i & data_ready_q
+                         & ~(data_wants_ram & traffic_gnt);
+    assign instr_gnt_o = instr_req_i & instr_ready_q;
+    // the dma only gets the cycles nobody else wants
+    assign dma_gnt     = dma_req_q & ~data_wants_ram & ~traffic_req_q;
+
+    always_ff @(posedge clk_i, negedge rst_ni) begin: timing_model
+        if (~rst_ni) begin
+            instr_ready_q  <= 1'b1;
+            data_ready_q   <= 1'b1;
+            instr_rvalid_o <= '0;
+            data_rvalid_o  <= '0;
+            traffic_req_q  <= '0;
+            traffic_prio_q <= '0;
+            traffic_we_q   <= '0;
+            traffic_addr_q <= '0;
+            traffic_wdata_q <= '0;
+
+        end else begin
+            mem_timing_tick(instr_req_i, instr_gnt_o, 32'(instr_addr_i),
+                            data_req_i, data_gnt_o, data_addr_i,
+                            instr_ready, instr_rvalid,
+                            data_ready, data_rvalid);
+            instr_ready_q  <= instr_ready;
+            data_ready_q   <= data_ready;
+            instr_rvalid_o <= instr_rvalid;
+            data_rvalid_o  <= data_rvalid;
+
+            mem_traffic_tick(data_wants_ram, traffic_gnt,
+                             traffic_req, traffic_prio, traffic_addr,
+                             traffic_we, traffic_wdata);
+            traffic_req_q   <= traffic_req;
+            traffic_prio_q  <= traffic_prio;
+            traffic_we_q    <= traffic_we;
+            traffic_addr_q  <= traffic_addr;
+            traffic_wdata_q <= traffic_wdata;
 
-    always_ff @(posedge clk_i) begin
+        end
+    end
+
+    // the dma engine, see dma.cpp for its registers
+    always_ff @(posedge clk_i, negedge rst_ni) begin: dma_model
+        if (~rst_ni) begin
+            dma_rdata_q <= '0;
+            dma_req_q   <= '0;
+            dma_we_q    <= '0;
+            dma_be_q    <= '0;
+            dma_addr_q  <= '0;
+            dma_wdata_q <= '0;
+            dma_irq_q   <= '0;
+
+        end else begin
+            if (dma_reg_valid) begin
+                if (data_we_i)
+                    dma_reg_write(data_addr_i, data_wdata_i);
+                else
+                    dma_rdata_q <= dma_reg_read(data_addr_i);
+            end
+
+            dma_tick(dma_gnt, ram_data_rdata,
+                     irq_ack_i && irq_id_i == DMA_IRQ_ID,
+                     dma_req, dma_addr, dma_we, dma_be, dma_wdata, dma_irq);
+            dma_req_q   <= dma_req;
+            dma_we_q    <= dma_we;
+            dma_be_q    <= dma_be[3:0];
+            dma_addr_q  <= dma_addr;
+            dma_wdata_q <= dma_wdata;
+            dma_irq_q   <= dma_irq;
+
+        end
+    end
+
+    // ram data that is not handed out in the cycle it arrives is kept for
+    // later, the oldest response always comes first
+    assign instr_push = instr_pending_q && !(instr_rvalid_o && instr_cnt_q == 0);
+    assign instr_pop  = instr_rvalid_o && instr_cnt_q != 0;
+    assign data_push  = data_pending_q && !(data_rvalid_o && data_cnt_q == 0);
+    assign data_pop   = data_rvalid_o && data_cnt_q != 0;
+
+    assign instr_rdata_o = instr_cnt_q == 0 ? ram_instr_rdata
+                                            : instr_fifo_q[instr_rptr_q];
+    assign data_rdata_o  = data_cnt_q == 0 ? data_rdata
+                                           : data_fifo_q[data_rptr_q];
+
+    always_ff @(posedge clk_i, negedge rst_ni) begin: response_fifos
+        if (~rst_ni) begin
+            instr_pending_q <= '0;
+            data_pending_q  <= '0;
+            instr_wptr_q    <= '0;
+            instr_rptr_q    <= '0;
+            instr_cnt_q     <= '0;
+            data_wptr_q     <= '0;
+            data_rptr_q     <= '0;
+            data_cnt_q      <= '0;
+
+        end else begin
+            instr_pending_q <= instr_req_i & instr_gnt_o;
+            data_pending_q  <= data_req_gnt;
+
+            if (instr_push) begin
+                instr_fifo_q[instr_wptr_q] <= ram_instr_rdata;
+                instr_wptr_q               <= instr_wptr_q + 1;
+            end
+            if (instr_pop)
+                instr_rptr_q <= instr_rptr_q + 1;
+            instr_cnt_q <= instr_cnt_q + instr_push - instr_pop;
+
+            if (data_push) begin
+                data_fifo_q[data_wptr_q] <= data_rdata;
+                data_wptr_q              <= data_wptr_q + 1;
+            end
+            if (data_pop)
+                data_rptr_q <= data_rptr_q + 1;
+            data_cnt_q <= data_cnt_q + data_push - data_pop;
+
+        end
     end
 
     always_ff @(posedge clk_i, negedge rst_ni) begin
         if (~rst_ni) begin
             select_rdata_q <= RAM;
-            data_rvalid_o  <= '0;
-            instr_rvalid_o <= '0;
 
         end else begin
             select_rdata_q <= select_rdata_d;
-            data_rvalid_o  <= data_req_i;
-            instr_rvalid_o <= instr_req_i;
 
         end
     end
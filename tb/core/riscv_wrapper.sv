@@ -15,7 +15,13 @@ module riscv_wrapper
     #(parameter INSTR_RDATA_WIDTH = 128,
       parameter RAM_ADDR_WIDTH = 20,
       parameter BOOT_ADDR = 'h80,
-      parameter PULP_SECURE = 1)
+      parameter PULP_SECURE = 1,
+      parameter APU_CUSTOM = 0,
+      parameter FAST_INT_DIV = 0,
+      parameter BRANCH_PREDICT = 0,
+      parameter MACRO_OP_FUSION = 0,
+      parameter LSU_OUTSTANDING = 0,
+      parameter SPARSE_MEM = 0)
     (input logic         clk_i,
      input logic         rst_ni,
 
@@ -41,6 +47,18 @@ module riscv_wrapper
     logic [31:0]                 data_rdata;
     logic [31:0]                 data_wdata;
 
+    // signals to the accelerator model
+    logic                        apu_req;
+    logic                        apu_ready;
+    logic                        apu_gnt;
+    logic [2:0][31:0]            apu_operands;
+    logic [5:0]                  apu_op;
+    logic                        apu_valid;
+    logic [31:0]                 apu_result;
+
+    // testbench events counted by the core, see mm_ram
+    logic [3:0]                  perf_events;
+
     // signals to debug unit
     logic                        debug_req_i;
 
@@ -59,7 +77,13 @@ module riscv_wrapper
     riscv_core
         #(.INSTR_RDATA_WIDTH (INSTR_RDATA_WIDTH),
           .PULP_SECURE(PULP_SECURE),
-          .FPU(0))
+          .FPU(0),
+          .APU_CUSTOM(APU_CUSTOM),
+          .FAST_INT_DIV(FAST_INT_DIV),
+          .BRANCH_PREDICT(BRANCH_PREDICT),
+          .MACRO_OP_FUSION(MACRO_OP_FUSION),
+          .LSU_OUTSTANDING(LSU_OUTSTANDING),
+          .N_EXT_PERF_COUNTERS(4))
     riscv_core_i
         (
          .clk_i                  ( clk_i                 ),
@@ -87,16 +111,16 @@ module riscv_wrapper
          .data_gnt_i             ( data_gnt              ),
          .data_rvalid_i          ( data_rvalid           ),
 
-         .apu_master_req_o       (                       ),
-         .apu_master_ready_o     (                       ),
-         .apu_master_gnt_i       (                       ),
-         .apu_master_operands_o  (                       ),
-         .apu_master_op_o        (                       ),
+         .apu_master_req_o       ( apu_req               ),
+         .apu_master_ready_o     ( apu_ready             ),
+         .apu_master_gnt_i       ( apu_gnt               ),
+         .apu_master_operands_o  ( apu_operands          ),
+         .apu_master_op_o        ( apu_op                ),
          .apu_master_type_o      (                       ),
          .apu_master_flags_o     (                       ),
-         .apu_master_valid_i     (                       ),
-         .apu_master_result_i    (                       ),
-         .apu_master_flags_i     (                       ),
+         .apu_master_valid_i     ( apu_valid             ),
+         .apu_master_result_i    ( apu_result            ),
+         .apu_master_flags_i     ( '0                    ),
 
          .irq_i                  ( irq                   ),
          .irq_id_i               ( irq_id_in             ),
@@ -111,12 +135,103 @@ module riscv_wrapper
          .fetch_enable_i         ( fetch_enable_i        ),
          .core_busy_o            ( core_busy_o           ),
 
-         .ext_perf_counters_i    (                       ),
+         .ext_perf_counters_i    ( perf_events           ),
          .fregfile_disable_i     ( 1'b0                  ));
 
+    // counters on the internals of the core
+    core_monitor core_monitor_i
+        (.clk_i              ( clk_i                                    ),
+         .rst_ni             ( rst_ni                                   ),
+
+         .instr_req_i        ( instr_req                                ),
+         .instr_gnt_i        ( instr_gnt                                ),
+         .instr_rvalid_i     ( instr_rvalid                             ),
+         .fetch_valid_i      ( riscv_core_i.if_stage_i.fetch_valid      ),
+         .fetch_ready_i      ( riscv_core_i.if_stage_i.fetch_ready      ),
+         .if_req_i           ( riscv_core_i.if_stage_i.req_i            ),
+         .id_ready_i         ( riscv_core_i.if_stage_i.id_ready_i       ),
+         .halt_if_i          ( riscv_core_i.if_stage_i.halt_if_i        ),
+         .pc_set_i           ( riscv_core_i.if_stage_i.pc_set_i         ),
+         .hwlp_jump_i        ( riscv_core_i.if_stage_i.hwlp_jump        ),
+
+         .pc_id_i            ( riscv_core_i.pc_id                       ),
+         .pc_mux_i           ( riscv_core_i.pc_mux_id                   ),
+         .instr_valid_id_i   ( riscv_core_i.instr_valid_id              ),
+         .id_valid_i         ( riscv_core_i.id_valid                    ),
+         .is_decoding_i      ( riscv_core_i.is_decoding                 ),
+         .sleeping_i         ( riscv_core_i.sleeping                    ),
+         .ctrl_busy_i        ( riscv_core_i.ctrl_busy                   ),
+         .first_fetch_i      ( riscv_core_i.core_ctrl_firstfetch        ),
+         .debug_mode_i       ( riscv_core_i.debug_mode                  ),
+         .pc_ex_i            ( riscv_core_i.pc_ex                       ),
+         .jump_target_ex_i   ( riscv_core_i.jump_target_ex              ),
+         .branch_in_ex_i     ( riscv_core_i.branch_in_ex                ),
+         .branch_taken_i     ( riscv_core_i.branch_in_ex
+                               & riscv_core_i.branch_decision           ),
+         .branch_pred_i      ( riscv_core_i.branch_pred_ex              ),
+         .pred_redirect_i    ( riscv_core_i.if_stage_i.branch_pred_q
+                               & ~riscv_core_i.pc_set                   ),
+         .jump_in_dec_i      ( riscv_core_i.id_stage_i.jump_in_dec      ),
+         .load_stall_i       ( riscv_core_i.id_stage_i.load_stall       ),
+         .jr_stall_i         ( riscv_core_i.id_stage_i.jr_stall         ),
+         .misaligned_stall_i ( riscv_core_i.id_stage_i.misaligned_stall ),
+         .apu_stall_id_i     ( riscv_core_i.id_stage_i.apu_stall        ),
+         .csr_apu_stall_i    ( riscv_core_i.id_stage_i.csr_apu_stall    ),
+         .apu_stall_ex_i     ( riscv_core_i.ex_stage_i.apu_stall        ),
+         .wb_contention_i    ( riscv_core_i.ex_stage_i.wb_contention    ),
+         .alu_ready_i        ( riscv_core_i.ex_stage_i.alu_ready        ),
+         .mult_ready_i       ( riscv_core_i.ex_stage_i.mult_ready       ),
+         .lsu_ready_ex_i     ( riscv_core_i.lsu_ready_ex                ),
+         .lsu_ready_wb_i     ( riscv_core_i.lsu_ready_wb                ),
+
+         .hwlp_we_i          ( riscv_core_i.id_stage_i.hwloop_we        ),
+         .hwlp_we_instr_i    ( |riscv_core_i.id_stage_i.hwloop_we_int   ),
+         .hwlp_regid_i       ( riscv_core_i.id_stage_i.hwloop_regid     ),
+         .hwlp_cnt_i         ( riscv_core_i.id_stage_i.hwloop_cnt       ),
+         .hwlp_start_i       ( riscv_core_i.hwlp_start                  ),
+         .hwlp_end_i         ( riscv_core_i.hwlp_end                    ),
+         .hwlp_valid_i       ( riscv_core_i.id_stage_i.hwloop_valid     ),
+         .hwlp_dec_cnt_i     ( riscv_core_i.hwlp_dec_cnt_id             ),
+
+         .ex_ready_i         ( riscv_core_i.ex_ready                    ),
+         .alu_en_ex_i        ( riscv_core_i.alu_en_ex                   ),
+         .alu_operator_ex_i  ( riscv_core_i.alu_operator_ex             ),
+         .alu_op_a_ex_i      ( riscv_core_i.alu_operand_a_ex            ),
+         .alu_op_b_ex_i      ( riscv_core_i.alu_operand_b_ex            ),
+         .mult_en_ex_i       ( riscv_core_i.mult_en_ex                  ),
+         .mult_operator_ex_i ( riscv_core_i.mult_operator_ex            ),
+         .mult_signed_ex_i   ( riscv_core_i.mult_signed_mode_ex         ),
+         .mult_op_a_ex_i     ( riscv_core_i.mult_operand_a_ex           ),
+         .mult_op_b_ex_i     ( riscv_core_i.mult_operand_b_ex           ),
+
+         .instr_id_i         ( riscv_core_i.instr_rdata_id              ),
+         .jr_fused_i         ( riscv_core_i.id_stage_i.jr_fused         ),
+
+         .perf_events_i      ( perf_events                              ));
+
+
+    // custom instructions are computed by a c++ model
+    if (APU_CUSTOM) begin: apu
+        apu_stub #(.NB_PORTS (1)) apu_stub_i
+            (.clk_i      ( clk_i        ),
+             .rst_ni     ( rst_ni       ),
+             .req_i      ( apu_req      ),
+             .ready_i    ( apu_ready    ),
+             .gnt_o      ( apu_gnt      ),
+             .operands_i ( apu_operands ),
+             .op_i       ( apu_op       ),
+             .valid_o    ( apu_valid    ),
+             .result_o   ( apu_result   ));
+    end else begin: no_apu
+        assign apu_gnt    = 1'b0;
+        assign apu_valid  = 1'b0;
+        assign apu_result = '0;
+    end
+
     // this handles read to RAM and memory mapped pseudo peripherals
     mm_ram
-        #(.RAM_ADDR_WIDTH (RAM_ADDR_WIDTH))
+        #(.RAM_ADDR_WIDTH (RAM_ADDR_WIDTH),
+          .SPARSE_MEM (SPARSE_MEM))
     ram_i
         (.clk_i          ( clk_i                          ),
          .rst_ni         ( rst_ni                         ),
@@ -144,6 +259,8 @@ module riscv_wrapper
          .tests_passed_o ( tests_passed_o                 ),
          .tests_failed_o ( tests_failed_o                 ),
          .exit_valid_o   ( exit_valid_o                   ),
-         .exit_value_o   ( exit_value_o                   ));
+         .exit_value_o   ( exit_value_o                   ),
+
+         .perf_events_o  ( perf_events                    ));
 
 endmodule // riscv_wrapper
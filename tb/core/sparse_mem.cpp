@@ -0,0 +1,171 @@
+// Copyright 2019 ETH Zurich and University of Bologna.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Sparse memory behind dp_ram.sv when it is built with SPARSE=1. The address
+// space is cut into 4k pages that are only allocated when they are written
+// first, reading a page that was never written returns zeros. The footprint
+// of a simulation then depends on how much memory the program touches and not
+// on ADDR_WIDTH. Every dp_ram gets its own memory through a chandle, so
+// several instances in one simulation don't share anything.
+//
+// Firmware is loaded from the same hex files as $readmemh takes, as written by
+// objcopy -O verilog: @<byte address> followed by bytes.
+
+#include "svdpi.h"
+
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#define SPARSE_PAGE_BITS 12
+#define SPARSE_PAGE_SIZE (1u << SPARSE_PAGE_BITS)
+
+struct sparse_mem {
+    uint64_t mask; // addresses wrap around like in the flat memory
+    std::unordered_map<uint64_t, std::unique_ptr<uint8_t[]>> pages;
+
+    // most accesses hit the same page as the one before
+    uint64_t last_page;
+    uint8_t *last;
+
+    // statistics
+    uint64_t reads;
+    uint64_t writes;
+};
+
+// the page of addr, NULL if it was never written and alloc is false
+static uint8_t *sparse_page(sparse_mem *m, uint64_t addr, bool alloc)
+{
+    uint64_t page = (addr & m->mask) >> SPARSE_PAGE_BITS;
+
+    if (m->last && page == m->last_page)
+        return m->last;
+
+    auto it = m->pages.find(page);
+    if (it == m->pages.end()) {
+        if (!alloc)
+            return NULL;
+        it = m->pages.emplace(page, std::unique_ptr<uint8_t[]>(
+                                        new uint8_t[SPARSE_PAGE_SIZE]()))
+                 .first;
+    }
+    m->last_page = page;
+    m->last      = it->second.get();
+    return m->last;
+}
+
+static uint8_t sparse_read_byte(sparse_mem *m, uint64_t addr)
+{
+    uint8_t *p = sparse_page(m, addr, false);
+    return p ? p[addr & (SPARSE_PAGE_SIZE - 1)] : 0;
+}
+
+static void sparse_write_byte(sparse_mem *m, uint64_t addr, uint8_t val)
+{
+    sparse_page(m, addr, true)[addr & (SPARSE_PAGE_SIZE - 1)] = val;
+}
+
+extern "C" void *sparse_mem_new(int addr_width)
+{
+    sparse_mem *m = new sparse_mem();
+
+    if (addr_width < SPARSE_PAGE_BITS || addr_width > 32) {
+        fprintf(stderr, "sparse_mem: address width must be %d..32, not %d\n",
+                SPARSE_PAGE_BITS, addr_width);
+        exit(1);
+    }
+    m->mask = (1ull << addr_width) - 1;
+    return m;
+}
+
+// little endian word at any byte address
+extern "C" int sparse_mem_read(void *h, int addr)
+{
+    sparse_mem *m = (sparse_mem *)h;
+    uint32_t a    = addr;
+    uint32_t val  = 0;
+
+    m->reads++;
+    // fast path, the whole word is in one page
+    if ((a & (SPARSE_PAGE_SIZE - 1)) <= SPARSE_PAGE_SIZE - 4) {
+        uint8_t *p = sparse_page(m, a, false);
+        if (p)
+            memcpy(&val, p + (a & (SPARSE_PAGE_SIZE - 1)), 4);
+        return val;
+    }
+    for (int i = 3; i >= 0; i--)
+        val = val << 8 | sparse_read_byte(m, (uint64_t)a + i);
+    return val;
+}
+
+extern "C" void sparse_mem_write(void *h, int addr, int data, int be)
+{
+    sparse_mem *m = (sparse_mem *)h;
+
+    m->writes++;
+    for (int i = 0; i < 4; i++)
+        if (be & 1 << i)
+            sparse_write_byte(m, (uint32_t)addr + i, (uint32_t)data >> 8 * i);
+}
+
+extern "C" void sparse_mem_load_hex(void *h, const char *path)
+{
+    sparse_mem *m = (sparse_mem *)h;
+    std::ifstream file(path);
+    std::string word;
+    uint64_t addr = 0;
+
+    if (!file) {
+        fprintf(stderr, "sparse_mem: cannot open %s\n", path);
+        exit(1);
+    }
+    while (file >> word) {
+        if (word.compare(0, 2, "//") == 0) {
+            std::getline(file, word);
+            continue;
+        }
+        if (word[0] == '@') {
+            addr = strtoull(word.c_str() + 1, NULL, 16);
+            continue;
+        }
+        if (!isxdigit((unsigned char)word[0])) {
+            fprintf(stderr, "sparse_mem: bad data %s in %s\n", word.c_str(),
+                    path);
+            exit(1);
+        }
+        sparse_write_byte(m, addr++, strtoul(word.c_str(), NULL, 16));
+    }
+}
+
+extern "C" void sparse_mem_report(void *h)
+{
+    sparse_mem *m = (sparse_mem *)h;
+
+    printf("sparse_mem: %zu pages (%zu KiB) of %llu MiB touched, %llu reads, "
+           "%llu writes\n",
+           m->pages.size(), m->pages.size() * SPARSE_PAGE_SIZE / 1024,
+           (unsigned long long)((m->mask + 1) >> 20),
+           (unsigned long long)m->reads, (unsigned long long)m->writes);
+}
+
+extern "C" void sparse_mem_free(void *h)
+{
+    delete (sparse_mem *)h;
+}
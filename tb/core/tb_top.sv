@@ -16,7 +16,13 @@
 module tb_top
     #(parameter INSTR_RDATA_WIDTH = 128,
       parameter RAM_ADDR_WIDTH = 22,
-      parameter BOOT_ADDR  = 'h80);
+      parameter BOOT_ADDR  = 'h80,
+      parameter APU_CUSTOM = 0,
+      parameter FAST_INT_DIV = 0,
+      parameter BRANCH_PREDICT = 0,
+      parameter MACRO_OP_FUSION = 0,
+      parameter LSU_OUTSTANDING = 0,
+      parameter SPARSE_MEM = 0);
 
     // comment to record execution trace
     //`define TRACE_EXECUTION
@@ -64,7 +70,9 @@ module tb_top
             if($test$plusargs("verbose"))
                 $display("[TESTBENCH] %t: loading firmware %0s ...",
                          $time, firmware);
-            $readmemh(firmware, riscv_wrapper_i.ram_i.dp_ram_i.mem);
+            // the sparse memory loads it by itself
+            if (!SPARSE_MEM)
+                $readmemh(firmware, riscv_wrapper_i.ram_i.dp_ram_i.mem);
 
         end else begin
             $display("No firmware specified");
@@ -125,7 +133,13 @@ module tb_top
         #(.INSTR_RDATA_WIDTH (INSTR_RDATA_WIDTH),
           .RAM_ADDR_WIDTH (RAM_ADDR_WIDTH),
           .BOOT_ADDR (BOOT_ADDR),
-          .PULP_SECURE (1))
+          .PULP_SECURE (1),
+          .APU_CUSTOM (APU_CUSTOM),
+          .FAST_INT_DIV (FAST_INT_DIV),
+          .BRANCH_PREDICT (BRANCH_PREDICT),
+          .MACRO_OP_FUSION (MACRO_OP_FUSION),
+          .LSU_OUTSTANDING (LSU_OUTSTANDING),
+          .SPARSE_MEM (SPARSE_MEM))
 
     riscv_wrapper_i
         (.clk_i          ( clk          ),
@@ -50,6 +50,7 @@ int main(int argc, char **argv, char **env)
 #endif
         t += 5;
     }
+    top->final();
 #ifdef VCD_TRACE
     tfp->close();
 #endif
@@ -14,7 +14,13 @@
 module tb_top_verilator
     #(parameter INSTR_RDATA_WIDTH = 128,
       parameter RAM_ADDR_WIDTH = 22,
-      parameter BOOT_ADDR  = 'h80)
+      parameter BOOT_ADDR  = 'h80,
+      parameter APU_CUSTOM = 0,
+      parameter FAST_INT_DIV = 0,
+      parameter BRANCH_PREDICT = 0,
+      parameter MACRO_OP_FUSION = 0,
+      parameter LSU_OUTSTANDING = 0,
+      parameter SPARSE_MEM = 0)
     (input logic clk_i,
      input logic  rst_ni,
      input logic  fetch_enable_i,
@@ -31,7 +37,9 @@ module tb_top_verilator
             if($test$plusargs("verbose"))
                 $display("[TESTBENCH] %t: loading firmware %0s ...",
                          $time, firmware);
-            $readmemh(firmware, riscv_wrapper_i.ram_i.dp_ram_i.mem);
+            // the sparse memory loads it by itself
+            if (!SPARSE_MEM)
+                $readmemh(firmware, riscv_wrapper_i.ram_i.dp_ram_i.mem);
 
         end else begin
             $display("No firmware specified");
@@ -56,6 +64,12 @@ module tb_top_verilator
         #(.INSTR_RDATA_WIDTH (INSTR_RDATA_WIDTH),
           .RAM_ADDR_WIDTH (RAM_ADDR_WIDTH),
           .BOOT_ADDR (BOOT_ADDR),
+          .APU_CUSTOM (APU_CUSTOM),
+          .FAST_INT_DIV (FAST_INT_DIV),
+          .BRANCH_PREDICT (BRANCH_PREDICT),
+          .MACRO_OP_FUSION (MACRO_OP_FUSION),
+          .LSU_OUTSTANDING (LSU_OUTSTANDING),
+          .SPARSE_MEM (SPARSE_MEM),
           .PULP_SECURE (0)) // need to disable because non-blocking and blocking
                             // assignment to same variable
     riscv_wrapper_i
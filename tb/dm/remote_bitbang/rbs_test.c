@@ -25,10 +25,11 @@ int main()
     unsigned char jtag_TDO = 0;
 
     printf("calling rbs_init\n");
-    int v = rbs_init(0);
+    struct rbs *rbs = rbs_init(0);
 
     printf("tick 1\n");
-    rbs_tick(&jtag_TCK, &jtag_TMS, &jtag_TDI, &jtag_TRSTn, jtag_TDO);
-    printf("jtag exit is %d\n", rbs_done());
+    rbs_tick(rbs, &jtag_TCK, &jtag_TMS, &jtag_TDI, &jtag_TRSTn, jtag_TDO);
+    printf("jtag exit is %d\n", rbs_done(rbs));
+    rbs_free(rbs);
     return 0;
 }
@@ -3,8 +3,11 @@
 #include <arpa/inet.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <netinet/tcp.h>
+#include <poll.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/un.h>
 #include <unistd.h>
 
 #include <assert.h>
@@ -13,24 +16,70 @@
 
 #include "remote_bitbang.h"
 
-int rbs_init(uint16_t port)
+static struct rbs *rbs_alloc()
 {
-    socket_fd  = 0;
-    client_fd  = 0;
-    recv_start = 0;
-    recv_end   = 0;
-    rbs_err    = 0;
-
-    socket_fd = socket(AF_INET, SOCK_STREAM, 0);
-    if (socket_fd == -1) {
+    struct rbs *rbs = calloc(1, sizeof(*rbs));
+    if (!rbs) {
+        fprintf(stderr, "remote_bitbang failed to allocate server state\n");
+        abort();
+    }
+
+    rbs->idle_divisor = 64;
+    const char *divisor = getenv("JTAG_IDLE_DIVISOR");
+    if (divisor) {
+        rbs->idle_divisor = strtol(divisor, NULL, 0);
+        if (rbs->idle_divisor < 1) {
+            fprintf(stderr, "JTAG_IDLE_DIVISOR must be positive, ignoring %s\n",
+                    divisor);
+            rbs->idle_divisor = 64;
+        }
+    }
+
+    const char *verbose = getenv("JTAG_VERBOSE");
+    if (verbose)
+        rbs->verbose = strtol(verbose, NULL, 0);
+
+    rbs->stats_interval = -1;
+    rbs->stats_file     = getenv("JTAG_STATS_FILE");
+    const char *interval = getenv("JTAG_STATS");
+    if (interval)
+        rbs->stats_interval = strtol(interval, NULL, 0);
+    else if (rbs->stats_file)
+        rbs->stats_interval = 0;
+    clock_gettime(CLOCK_MONOTONIC, &rbs->stats.start);
+    rbs->stats_last = rbs->stats.start;
+
+    rbs->tck   = 1;
+    rbs->tms   = 1;
+    rbs->tdi   = 1;
+    rbs->trstn = 1;
+    rbs->quit  = 0;
+    return rbs;
+}
+
+static void rbs_listen(struct rbs *rbs)
+{
+    if (listen(rbs->socket_fd, 1) == -1) {
+        fprintf(stderr, "remote_bitbang failed to listen on socket: %s (%d)\n",
+                strerror(errno), errno);
+        abort();
+    }
+}
+
+struct rbs *rbs_init(uint16_t port)
+{
+    struct rbs *rbs = rbs_alloc();
+
+    rbs->socket_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (rbs->socket_fd == -1) {
         fprintf(stderr, "remote_bitbang failed to make socket: %s (%d)\n",
                 strerror(errno), errno);
         abort();
     }
 
-    fcntl(socket_fd, F_SETFL, O_NONBLOCK);
+    fcntl(rbs->socket_fd, F_SETFL, O_NONBLOCK);
     int reuseaddr = 1;
-    if (setsockopt(socket_fd, SOL_SOCKET, SO_REUSEADDR, &reuseaddr,
+    if (setsockopt(rbs->socket_fd, SOL_SOCKET, SO_REUSEADDR, &reuseaddr,
                    sizeof(int)) == -1) {
         fprintf(stderr, "remote_bitbang failed setsockopt: %s (%d)\n",
                 strerror(errno), errno);
@@ -43,233 +92,408 @@ int rbs_init(uint16_t port)
     addr.sin_addr.s_addr = INADDR_ANY;
     addr.sin_port        = htons(port);
 
-    if (bind(socket_fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+    if (bind(rbs->socket_fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
         fprintf(stderr, "remote_bitbang failed to bind socket: %s (%d)\n",
                 strerror(errno), errno);
         abort();
     }
 
-    if (listen(socket_fd, 1) == -1) {
-        fprintf(stderr, "remote_bitbang failed to listen on socket: %s (%d)\n",
+    rbs_listen(rbs);
+
+    socklen_t addrlen = sizeof(addr);
+    if (getsockname(rbs->socket_fd, (struct sockaddr *)&addr, &addrlen) == -1) {
+        fprintf(stderr, "remote_bitbang getsockname failed: %s (%d)\n",
                 strerror(errno), errno);
         abort();
     }
 
-    socklen_t addrlen = sizeof(addr);
-    if (getsockname(socket_fd, (struct sockaddr *)&addr, &addrlen) == -1) {
-        fprintf(stderr, "remote_bitbang getsockname failed: %s (%d)\n",
+    rbs->port = ntohs(addr.sin_port);
+
+    fprintf(stderr, "JTAG remote bitbang server is ready\n");
+    fprintf(stderr, "Listening on port %d\n", rbs->port);
+    return rbs;
+}
+
+struct rbs *rbs_init_unix(const char *path)
+{
+    struct rbs *rbs = rbs_alloc();
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "remote_bitbang socket path too long: %s\n", path);
+        abort();
+    }
+    strcpy(addr.sun_path, path);
+    strcpy(rbs->path, path);
+
+    rbs->socket_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (rbs->socket_fd == -1) {
+        fprintf(stderr, "remote_bitbang failed to make socket: %s (%d)\n",
                 strerror(errno), errno);
         abort();
     }
 
-    tck   = 1;
-    tms   = 1;
-    tdi   = 1;
-    trstn = 1;
-    quit  = 0;
+    fcntl(rbs->socket_fd, F_SETFL, O_NONBLOCK);
+
+    // a stale socket of an earlier run would make bind() fail
+    unlink(path);
+    if (bind(rbs->socket_fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+        fprintf(stderr, "remote_bitbang failed to bind socket %s: %s (%d)\n",
+                path, strerror(errno), errno);
+        abort();
+    }
+
+    rbs_listen(rbs);
 
     fprintf(stderr, "JTAG remote bitbang server is ready\n");
-    fprintf(stderr, "Listening on port %d\n", ntohs(addr.sin_port));
-    return 1;
+    fprintf(stderr, "Listening on unix socket %s\n", rbs->path);
+    return rbs;
 }
 
-void rbs_accept()
+void rbs_free(struct rbs *rbs)
 {
-    fprintf(stderr, "Attempting to accept client socket\n");
-    int again = 1;
-    while (again != 0) {
-        client_fd = accept(socket_fd, NULL, NULL);
-        if (client_fd == -1) {
-            if (errno == EAGAIN) {
-                // No client waiting to connect right now.
-            } else {
-                fprintf(stderr, "failed to accept on socket: %s (%d)\n",
-                        strerror(errno), errno);
-                again = 0;
-                abort();
-            }
-        } else {
-            fcntl(client_fd, F_SETFL, O_NONBLOCK);
-            fprintf(stderr, "Accepted successfully.");
-            again = 0;
-        }
+    if (rbs->client_fd > 0)
+        close(rbs->client_fd);
+    if (rbs->socket_fd > 0)
+        close(rbs->socket_fd);
+    if (rbs->path[0])
+        unlink(rbs->path);
+    free(rbs);
+}
+
+static double rbs_elapsed(const struct timespec *from,
+                          const struct timespec *to)
+{
+    return (to->tv_sec - from->tv_sec) + (to->tv_nsec - from->tv_nsec) * 1e-9;
+}
+
+static double rbs_ratio(uint64_t num, uint64_t den)
+{
+    return den ? (double)num / den : 0.0;
+}
+
+static void rbs_report_stats(struct rbs *rbs)
+{
+    struct rbs_stats *st = &rbs->stats;
+    struct timespec now;
+    char name[sizeof(rbs->path) + 8];
+
+    if (rbs->path[0])
+        snprintf(name, sizeof(name), "%s", rbs->path);
+    else
+        snprintf(name, sizeof(name), "port %d", rbs->port);
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    rbs->stats_last = now;
+    double secs     = rbs_elapsed(&st->start, &now);
+    if (secs <= 0)
+        secs = 1e-9;
+
+    fprintf(stderr,
+            "JTAG stats (%s): %.1f s, %llu commands (%.0f/s), "
+            "%llu R in %llu round trips (%.0f/s), %llu TCK edges "
+            "(%.1f ticks/edge), %.1f%% of %llu ticks idle, "
+            "%.1f bytes/read, %.1f bytes/write\n",
+            name, secs,
+            (unsigned long long)st->commands, st->commands / secs,
+            (unsigned long long)st->reads,
+            (unsigned long long)st->round_trips, st->round_trips / secs,
+            (unsigned long long)st->tck_edges,
+            rbs_ratio(st->ticks, st->tck_edges),
+            100.0 * rbs_ratio(st->idle_ticks, st->ticks),
+            (unsigned long long)st->ticks,
+            rbs_ratio(st->bytes_read, st->read_calls),
+            rbs_ratio(st->bytes_written, st->write_calls));
+
+    if (!rbs->stats_file)
+        return;
+
+    FILE *f = fopen(rbs->stats_file, "w");
+    if (!f) {
+        fprintf(stderr, "remote_bitbang failed to open %s: %s (%d)\n",
+                rbs->stats_file, strerror(errno), errno);
+        return;
+    }
+    fprintf(f, "seconds=%.6f\n", secs);
+    fprintf(f, "ticks=%llu\n", (unsigned long long)st->ticks);
+    fprintf(f, "idle_ticks=%llu\n", (unsigned long long)st->idle_ticks);
+    fprintf(f, "commands=%llu\n", (unsigned long long)st->commands);
+    fprintf(f, "tck_edges=%llu\n", (unsigned long long)st->tck_edges);
+    fprintf(f, "reads=%llu\n", (unsigned long long)st->reads);
+    fprintf(f, "round_trips=%llu\n", (unsigned long long)st->round_trips);
+    fprintf(f, "read_calls=%llu\n", (unsigned long long)st->read_calls);
+    fprintf(f, "bytes_read=%llu\n", (unsigned long long)st->bytes_read);
+    fprintf(f, "write_calls=%llu\n", (unsigned long long)st->write_calls);
+    fprintf(f, "bytes_written=%llu\n", (unsigned long long)st->bytes_written);
+    fclose(f);
+}
+
+void rbs_accept(struct rbs *rbs)
+{
+    // Other servers in this process and the simulation itself have to keep
+    // going while we wait, so we only peek at the listening socket every
+    // idle_divisor ticks instead of blocking in accept().
+    if (rbs->idle_ticks++ % rbs->idle_divisor)
+        return;
+
+    struct pollfd pfd = {.fd = rbs->socket_fd, .events = POLLIN};
+    int ready = poll(&pfd, 1, 0);
+    if (ready == -1 && errno != EINTR) {
+        fprintf(stderr, "failed to poll on socket: %s (%d)\n", strerror(errno),
+                errno);
+        abort();
+    }
+    if (ready <= 0)
+        return;
+
+    rbs->client_fd = accept(rbs->socket_fd, NULL, NULL);
+    if (rbs->client_fd == -1) {
+        rbs->client_fd = 0;
+        if (errno == EAGAIN || errno == EINTR)
+            return; // client went away before we got to it
+        fprintf(stderr, "failed to accept on socket: %s (%d)\n",
+                strerror(errno), errno);
+        abort();
     }
+
+    fcntl(rbs->client_fd, F_SETFL, O_NONBLOCK);
+    if (!rbs->path[0]) {
+        // We batch the responses ourselves, don't let Nagle hold them back
+        int nodelay = 1;
+        setsockopt(rbs->client_fd, IPPROTO_TCP, TCP_NODELAY, &nodelay,
+                   sizeof(nodelay));
+        fprintf(stderr, "Accepted successfully on port %d.\n", rbs->port);
+    } else {
+        fprintf(stderr, "Accepted successfully on %s.\n", rbs->path);
+    }
+    rbs->idle_ticks = 0;
 }
 
-void rbs_tick(unsigned char *jtag_tck, unsigned char *jtag_tms,
-              unsigned char *jtag_tdi, unsigned char *jtag_trstn,
-              unsigned char jtag_tdo)
+void rbs_tick(struct rbs *rbs, unsigned char *jtag_tck,
+              unsigned char *jtag_tms, unsigned char *jtag_tdi,
+              unsigned char *jtag_trstn, unsigned char jtag_tdo)
 {
-    if (client_fd > 0) {
-        tdo = jtag_tdo;
-        rbs_execute_command();
+    uint64_t commands = rbs->stats.commands;
+
+    if (rbs->client_fd > 0) {
+        rbs->tdo = jtag_tdo;
+        rbs_execute_command(rbs);
     } else {
-        rbs_accept();
+        rbs_accept(rbs);
     }
 
-    *jtag_tck   = tck;
-    *jtag_tms   = tms;
-    *jtag_tdi   = tdi;
-    *jtag_trstn = trstn;
+    rbs->stats.ticks++;
+    if (rbs->stats.commands == commands)
+        rbs->stats.idle_ticks++;
+
+    // looking at the clock is cheap, but not cheap enough for every tick
+    if (rbs->stats_interval > 0 && !(rbs->stats.ticks & 0xfff)) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (rbs_elapsed(&rbs->stats_last, &now) >= rbs->stats_interval)
+            rbs_report_stats(rbs);
+    }
+
+    *jtag_tck   = rbs->tck;
+    *jtag_tms   = rbs->tms;
+    *jtag_tdi   = rbs->tdi;
+    *jtag_trstn = rbs->trstn;
 }
 
-void rbs_reset()
+void rbs_reset(struct rbs *rbs)
 {
-    // trstn = 0;
+    (void)rbs;
+    // rbs->trstn = 0;
 }
 
-void rbs_set_pins(char _tck, char _tms, char _tdi)
+void rbs_set_pins(struct rbs *rbs, char _tck, char _tms, char _tdi)
 {
-    tck = _tck;
-    tms = _tms;
-    tdi = _tdi;
+    rbs->tck = _tck;
+    rbs->tms = _tms;
+    rbs->tdi = _tdi;
 }
 
-void rbs_execute_command()
+void rbs_flush(struct rbs *rbs)
 {
-    char command;
-    int again = 1;
-    while (again) {
-        ssize_t num_read = read(client_fd, &command, sizeof(command));
-        if (num_read == -1) {
-            if (errno == EAGAIN) {
-                // We'll try again the next call.
-                if (VERBOSE)
-                    fprintf(
-                        stderr,
-                        "Received no command. Will try again on the next call\n");
-            } else {
+    ssize_t sent = 0;
+
+    if (rbs->send_end)
+        rbs->stats.round_trips++;
+
+    while (sent < rbs->send_end) {
+        ssize_t bytes = write(rbs->client_fd, rbs->send_buf + sent, rbs->send_end - sent);
+        rbs->stats.write_calls++;
+        if (bytes == -1) {
+            if (errno == EAGAIN || errno == EINTR)
+                continue;
+            fprintf(stderr, "failed to write to socket: %s (%d)\n",
+                    strerror(errno), errno);
+            abort();
+        }
+        sent += bytes;
+        rbs->stats.bytes_written += bytes;
+    }
+    rbs->send_end = 0;
+}
+
+// Refill recv_buf with whatever the client sent us since the last call. Returns
+// the number of bytes read, 0 if there is nothing to do for now.
+//
+// While commands are flowing we go straight for read(). Once the client has
+// gone quiet we only look at the socket every idle_divisor ticks, and then
+// only ask poll() whether there is something worth reading.
+static ssize_t rbs_fill(struct rbs *rbs)
+{
+    if (rbs->idle_ticks > 0) {
+        if (rbs->idle_ticks++ % rbs->idle_divisor)
+            return 0;
+
+        struct pollfd pfd = {.fd = rbs->client_fd, .events = POLLIN};
+        int ready = poll(&pfd, 1, 0);
+        if (ready == -1 && errno != EINTR) {
+            fprintf(stderr, "remote_bitbang failed to poll on socket: %s (%d)\n",
+                    strerror(errno), errno);
+            abort();
+        }
+        if (ready <= 0)
+            return 0;
+    }
+
+    ssize_t num_read = read(rbs->client_fd, rbs->recv_buf, RBS_BUF_SIZE);
+    rbs->stats.read_calls++;
+    if (num_read == -1) {
+        if (errno == EAGAIN || errno == EINTR) {
+            // We'll try again once the idle period is over.
+            if (rbs->verbose)
                 fprintf(stderr,
-                        "remote_bitbang failed to read on socket: %s (%d)\n",
-                        strerror(errno), errno);
-                again = 0;
-                abort();
-            }
-        } else if (num_read == 0) {
-            fprintf(stderr, "No command received. Stopping further reads.\n");
-            // again = 1;
-            return;
+                        "Received no command. Will try again on the next call\n");
+            rbs->idle_ticks = 1;
         } else {
-            again = 0;
+            fprintf(stderr, "remote_bitbang failed to read on socket: %s (%d)\n",
+                    strerror(errno), errno);
+            abort();
         }
+        return 0;
+    } else if (num_read == 0) {
+        // The client hung up without sending 'Q'. Drop it so that the next
+        // tick waits for a new connection.
+        fprintf(stderr, "Client closed the connection.\n");
+        close(rbs->client_fd);
+        rbs->client_fd  = 0;
+        rbs->idle_ticks = 0;
+        return 0;
     }
 
-    int dosend = 0;
-
-    char tosend = '?';
-
-    switch (command) {
-    case 'B':
-        if (VERBOSE)
-            fprintf(stderr, "*BLINK*\n");
-        break;
-    case 'b':
-        if (VERBOSE)
-            fprintf(stderr, "blink off\n");
-        break;
-    case 'r':
-        if (VERBOSE)
-            fprintf(stderr, "r-reset\n");
-        rbs_reset();
-        break; // This is wrong. 'r' has other bits that indicated TRST and
-               // SRST.
-    case 's':
-        if (VERBOSE)
-            fprintf(stderr, "s-reset\n");
-        rbs_reset();
-        break; // This is wrong.
-    case 't':
-        if (VERBOSE)
-            fprintf(stderr, "t-reset\n");
-        rbs_reset();
-        break; // This is wrong.
-    case 'u':
-        if (VERBOSE)
-            fprintf(stderr, "u-reset\n");
-        rbs_reset();
-        break; // This is wrong.
-    case '0':
-        if (VERBOSE)
-            fprintf(stderr, "Write 0 0 0\n");
-        rbs_set_pins(0, 0, 0);
-        break;
-    case '1':
-        if (VERBOSE)
-            fprintf(stderr, "Write 0 0 1\n");
-        rbs_set_pins(0, 0, 1);
-        break;
-    case '2':
-        if (VERBOSE)
-            fprintf(stderr, "Write 0 1 0\n");
-        rbs_set_pins(0, 1, 0);
-        break;
-    case '3':
-        if (VERBOSE)
-            fprintf(stderr, "Write 0 1 1\n");
-        rbs_set_pins(0, 1, 1);
-        break;
-    case '4':
-        if (VERBOSE)
-            fprintf(stderr, "Write 1 0 0\n");
-        rbs_set_pins(1, 0, 0);
-        break;
-    case '5':
-        if (VERBOSE)
-            fprintf(stderr, "Write 1 0 1\n");
-        rbs_set_pins(1, 0, 1);
-        break;
-    case '6':
-        if (VERBOSE)
-            fprintf(stderr, "Write 1 1 0\n");
-        rbs_set_pins(1, 1, 0);
-        break;
-    case '7':
-        if (VERBOSE)
-            fprintf(stderr, "Write 1 1 1\n");
-        rbs_set_pins(1, 1, 1);
-        break;
-    case 'R':
-        if (VERBOSE)
-            fprintf(stderr, "Read req\n");
-        dosend = 1;
-        tosend = tdo ? '1' : '0';
-        break;
-    case 'Q':
-        if (VERBOSE)
-            fprintf(stderr, "Quit req\n");
-        quit = 1;
-        break;
-    default:
-        fprintf(stderr, "remote_bitbang got unsupported command '%c'\n",
-                command);
-    }
-    if (dosend) {
-        while (1) {
-            ssize_t bytes = write(client_fd, &tosend, sizeof(tosend));
-            if (bytes == -1) {
-                fprintf(stderr, "failed to write to socket: %s (%d)\n",
-                        strerror(errno), errno);
-                abort();
-            }
-            if (bytes > 0) {
-                break;
-            }
+    rbs->recv_start = 0;
+    rbs->recv_end   = num_read;
+    rbs->idle_ticks = 0;
+    rbs->stats.bytes_read += num_read;
+    return num_read;
+}
+
+void rbs_execute_command(struct rbs *rbs)
+{
+    if (rbs->recv_start == rbs->recv_end && !rbs_fill(rbs))
+        return;
+
+    int pins_changed = 0;
+
+    while (!pins_changed && rbs->recv_start < rbs->recv_end) {
+        char command = rbs->recv_buf[rbs->recv_start++];
+        rbs->stats.commands++;
+
+        switch (command) {
+        case 'B':
+            if (rbs->verbose)
+                fprintf(stderr, "*BLINK*\n");
+            break;
+        case 'b':
+            if (rbs->verbose)
+                fprintf(stderr, "blink off\n");
+            break;
+        case 'r':
+            if (rbs->verbose)
+                fprintf(stderr, "r-reset\n");
+            rbs_reset(rbs);
+            break; // This is wrong. 'r' has other bits that indicated TRST and
+                   // SRST.
+        case 's':
+            if (rbs->verbose)
+                fprintf(stderr, "s-reset\n");
+            rbs_reset(rbs);
+            break; // This is wrong.
+        case 't':
+            if (rbs->verbose)
+                fprintf(stderr, "t-reset\n");
+            rbs_reset(rbs);
+            break; // This is wrong.
+        case 'u':
+            if (rbs->verbose)
+                fprintf(stderr, "u-reset\n");
+            rbs_reset(rbs);
+            break; // This is wrong.
+        case '0':
+        case '1':
+        case '2':
+        case '3':
+        case '4':
+        case '5':
+        case '6':
+        case '7':
+            if (rbs->verbose)
+                fprintf(stderr, "Write %d %d %d\n", (command >> 2) & 1,
+                        (command >> 1) & 1, command & 1);
+            if (((command >> 2) & 1) != rbs->tck)
+                rbs->stats.tck_edges++;
+            rbs_set_pins(rbs, (command >> 2) & 1, (command >> 1) & 1, command & 1);
+            pins_changed = 1;
+            break;
+        case 'R':
+            if (rbs->verbose)
+                fprintf(stderr, "Read req\n");
+            // tdo was sampled this tick, i.e. after the previous pin change
+            // had time to propagate
+            rbs->stats.reads++;
+            rbs->send_buf[rbs->send_end++] = rbs->tdo ? '1' : '0';
+            break;
+        case 'Q':
+            if (rbs->verbose)
+                fprintf(stderr, "Quit req\n");
+            rbs->quit = 1;
+            break;
+        default:
+            fprintf(stderr, "remote_bitbang got unsupported command '%c'\n",
+                    command);
         }
+
+        if (rbs->quit)
+            break;
     }
 
-    if (quit) {
+    // The client might be blocking on the responses so we have to flush them
+    // out before we go back to waiting for new commands.
+    if (rbs->recv_start == rbs->recv_end || rbs->quit)
+        rbs_flush(rbs);
+
+    if (rbs->quit) {
         fprintf(stderr, "Remote end disconnected\n");
-        close(client_fd);
-        client_fd = 0;
+        if (rbs->stats_interval >= 0)
+            rbs_report_stats(rbs);
+        close(rbs->client_fd);
+        rbs->client_fd  = 0;
+        rbs->recv_start = 0;
+        rbs->recv_end   = 0;
     }
 }
 
-unsigned char rbs_done()
+unsigned char rbs_done(struct rbs *rbs)
 {
-    return quit;
+    return rbs->quit;
 }
 
-int rbs_exit_code()
+int rbs_exit_code(struct rbs *rbs)
 {
-    return rbs_err;
+    return rbs->err;
 }
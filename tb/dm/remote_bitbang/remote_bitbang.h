@@ -5,48 +5,108 @@
 
 #include <stdint.h>
 #include <sys/types.h>
+#include <time.h>
 
-#define VERBOSE 0
+#define RBS_BUF_SIZE (64 * 1024)
 
-int rbs_err;
+// Counters for figuring out where the time of a debug session goes. They are
+// always collected, JTAG_STATS=<seconds> prints them every so many seconds of
+// wall time (0 only prints them when the client quits) and JTAG_STATS_FILE
+// writes them to a file in key=value form.
+struct rbs_stats {
+    uint64_t ticks;
+    uint64_t idle_ticks;     // ticks without a command to execute
+    uint64_t commands;
+    uint64_t tck_edges;
+    uint64_t reads;          // 'R' commands
+    uint64_t round_trips;    // batches of 'R' responses sent to the client
+    uint64_t read_calls;     // read() syscalls on the client socket
+    uint64_t bytes_read;
+    uint64_t write_calls;    // write() syscalls on the client socket
+    uint64_t bytes_written;
+    struct timespec start;
+};
 
-unsigned char tck;
-unsigned char tms;
-unsigned char tdi;
-unsigned char trstn;
-unsigned char tdo;
-unsigned char quit;
+// State of a single remote bitbang server. Every JTAG endpoint in the
+// simulation gets its own instance, so one process can serve several OpenOCD
+// connections at the same time.
+struct rbs {
+    uint16_t port;
+    // path of the unix domain socket, empty when listening on a TCP port
+    char path[108];
+    int err;
 
-int socket_fd;
-int client_fd;
+    unsigned char tck;
+    unsigned char tms;
+    unsigned char tdi;
+    unsigned char trstn;
+    unsigned char tdo;
+    unsigned char quit;
 
-static const ssize_t buf_size = 64 * 1024;
-char recv_buf[64 * 1024];
-ssize_t recv_start, recv_end;
+    int socket_fd;
+    int client_fd;
+
+    char recv_buf[RBS_BUF_SIZE];
+    ssize_t recv_start, recv_end;
+
+    // Responses to 'R' commands are collected here and written back to the
+    // client once the batch of commands they belong to has been processed.
+    char send_buf[RBS_BUF_SIZE];
+    ssize_t send_end;
+
+    // Number of ticks since the client last sent us something (0 while
+    // commands are flowing). While idle, or while no client is connected, we
+    // only check the socket every idle_divisor ticks, which can be set with the
+    // JTAG_IDLE_DIVISOR environment variable.
+    long idle_ticks;
+    long idle_divisor;
+
+    // JTAG_VERBOSE=1 traces every command, 2 also every tick
+    int verbose;
+
+    struct rbs_stats stats;
+    // seconds between two reports, negative if disabled
+    long stats_interval;
+    struct timespec stats_last;
+    const char *stats_file;
+};
 
 // Create a new server, listening for connections from localhost on the given
 // port.
-int rbs_init(uint16_t port);
+struct rbs *rbs_init(uint16_t port);
+
+// Create a new server, listening for connections on a unix domain socket at
+// the given path. This saves the TCP loopback overhead on every round trip when
+// OpenOCD runs on the same machine (remote_bitbang_port 0).
+struct rbs *rbs_init_unix(const char *path);
+
+// Close all sockets of the server and release it.
+void rbs_free(struct rbs *rbs);
 
 // Do a bit of work.
-void rbs_tick(unsigned char *jtag_tck, unsigned char *jtag_tms,
+void rbs_tick(struct rbs *rbs, unsigned char *jtag_tck, unsigned char *jtag_tms,
               unsigned char *jtag_tdi, unsigned char *jtag_trstn,
               unsigned char jtag_tdo);
 
-unsigned char rbs_done();
+unsigned char rbs_done(struct rbs *rbs);
 
-int rbs_exit_code();
+int rbs_exit_code(struct rbs *rbs);
 
 // Check for a client connecting, and accept if there is one.
-void rbs_accept();
-// Execute any commands the client has for us.
-// But we only execute 1 because we need time for the
-// simulation to run.
-void rbs_execute_command();
+void rbs_accept(struct rbs *rbs);
+// Execute any commands the client has for us. Everything the client has sent
+// so far is read into recv_buf with a single syscall and then consumed over
+// consecutive ticks. Commands which don't change the pins are handled right
+// away, but we stop after each pin change because the simulation needs time
+// to run.
+void rbs_execute_command(struct rbs *rbs);
+
+// Write all pending responses in send_buf to the client.
+void rbs_flush(struct rbs *rbs);
 
 // Reset. Currently does nothing.
-void rbs_reset();
+void rbs_reset(struct rbs *rbs);
 
-void rbs_set_pins(char _tck, char _tms, char _tdi);
+void rbs_set_pins(struct rbs *rbs, char _tck, char _tms, char _tdi);
 
 #endif
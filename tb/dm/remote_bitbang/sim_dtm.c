@@ -0,0 +1,341 @@
+// Copyright 2019 ETH Zurich and University of Bologna.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Native DMI driver for SimDTM. Instead of shifting every debug module access
+// through the JTAG TAP and DTM, debug_tick() puts DMI requests directly on the
+// bus, so one transaction only costs a few cycles.
+//
+// The transactions come from a dmi_source: either the gdb stub in sim_gdb.c
+// (GDB_PORT) or the one in here, which reads a simple debug program, selected
+// with the DMI_SCRIPT environment variable, either from a file (or fifo) or,
+// with a "unix:" prefix, from a client connecting to a unix domain socket at
+// that path. Every line holds one command, numbers are in C notation:
+//
+//   w <addr> <data>           write data to DMI register addr
+//   r <addr> [<val> [<mask>]] read addr, optionally check (data & mask) == val
+//   p <addr> <val> [<mask>]   read addr until (data & mask) == val
+//   d <cycles>                leave the bus idle for a while
+//   q [<code>]                end the simulation
+//
+// Blank lines and lines starting with # are ignored. A socket client gets one
+// reply line per command: the data for r, "ok" for everything else and
+// "error <resp>" for a failed transaction.
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "sim_dtm.h"
+
+struct sim_dtm {
+    struct dmi_source src;
+    int init;
+    int verbose; // JTAG_VERBOSE, like the remote bitbang server
+
+    // what we currently drive on the bus
+    unsigned char req_valid;
+    struct dmi_txn req;
+    // a request was accepted and we wait for its response
+    int busy;
+};
+
+static struct sim_dtm dtm;
+
+struct dmi_script {
+    FILE *in;
+    FILE *out; // reply channel for socket clients, NULL for files
+    int line;
+    int err;
+    int quit;
+    int exit_code;
+
+    // command we are working on
+    char cmd;
+    uint8_t addr;
+    uint32_t val, mask;
+    long delay;
+    int poll;
+};
+
+static void dmi_script_reply(struct dmi_script *s, const char *fmt,
+                             uint32_t val)
+{
+    if (!s->out)
+        return;
+    fprintf(s->out, fmt, val);
+    fputc('\n', s->out);
+    fflush(s->out);
+}
+
+static int dmi_script_next(void *ctx, struct dmi_txn *txn)
+{
+    struct dmi_script *s = ctx;
+    char buf[256];
+
+    if (s->delay > 0) {
+        if (--s->delay == 0)
+            dmi_script_reply(s, "ok", 0);
+        return 0;
+    }
+
+    if (s->poll) {
+        txn->op   = DMI_OP_READ;
+        txn->addr = s->addr;
+        txn->data = 0;
+        return 1;
+    }
+
+    while (!s->quit && s->in && fgets(buf, sizeof(buf), s->in)) {
+        char cmd;
+        unsigned long a = 0, b = 0, c = 0xffffffff;
+
+        s->line++;
+        int n = sscanf(buf, " %c %li %li %li", &cmd, &a, &b, &c);
+        if (n < 1 || cmd == '#')
+            continue;
+
+        s->cmd    = cmd;
+        s->addr   = a;
+        s->val    = b;
+        s->mask   = c;
+        txn->addr = a;
+        txn->data = 0;
+        txn->op   = DMI_OP_READ;
+
+        switch (cmd) {
+        case 'w':
+            if (n < 3)
+                break;
+            txn->op   = DMI_OP_WRITE;
+            txn->data = b;
+            return 1;
+        case 'r':
+            if (n < 2)
+                break;
+            if (n < 3)
+                s->mask = 0;
+            return 1;
+        case 'p':
+            if (n < 3)
+                break;
+            return 1;
+        case 'd':
+            if (n < 2)
+                break;
+            s->delay = a;
+            if (s->delay == 0)
+                dmi_script_reply(s, "ok", 0);
+            return 0;
+        case 'q':
+            s->quit      = 1;
+            s->exit_code = n > 1 ? (int)a : 0;
+            dmi_script_reply(s, "ok", 0);
+            return 0;
+        default:
+            break;
+        }
+        fprintf(stderr, "sim_dtm: malformed command in line %d: %s", s->line,
+                buf);
+        s->err = 1;
+        dmi_script_reply(s, "error %u", DMI_RESP_FAILED);
+    }
+
+    return 0;
+}
+
+static void dmi_script_done(void *ctx, const struct dmi_txn *txn,
+                            uint32_t data, int resp)
+{
+    struct dmi_script *s = ctx;
+
+    s->poll = 0;
+    if (resp != DMI_RESP_SUCCESS) {
+        fprintf(stderr, "sim_dtm: line %d: DMI %s of 0x%02x failed (%d)\n",
+                s->line, txn->op == DMI_OP_WRITE ? "write" : "read",
+                txn->addr, resp);
+        s->err = 1;
+        dmi_script_reply(s, "error %u", resp);
+        return;
+    }
+
+    switch (s->cmd) {
+    case 'w':
+        dmi_script_reply(s, "ok", 0);
+        break;
+    case 'r':
+        if (!s->out)
+            printf("DMI read 0x%02x: 0x%08x\n", txn->addr, data);
+        if ((data & s->mask) != (s->val & s->mask)) {
+            fprintf(stderr,
+                    "sim_dtm: line %d: read 0x%08x from 0x%02x, expected "
+                    "0x%08x (mask 0x%08x)\n",
+                    s->line, data, txn->addr, s->val, s->mask);
+            s->err = 1;
+        }
+        dmi_script_reply(s, "%08x", data);
+        break;
+    case 'p':
+        if ((data & s->mask) != (s->val & s->mask)) {
+            // not there yet, issue the same read again
+            s->poll = 1;
+        } else {
+            dmi_script_reply(s, "ok", 0);
+        }
+        break;
+    }
+}
+
+static int dmi_script_quit(void *ctx, int *code)
+{
+    struct dmi_script *s = ctx;
+
+    *code = s->exit_code ? s->exit_code : s->err;
+    return s->quit;
+}
+
+static FILE *dmi_script_accept(const char *path)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "sim_dtm: socket path too long: %s\n", path);
+        abort();
+    }
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1) {
+        fprintf(stderr, "sim_dtm: failed to make socket: %s (%d)\n",
+                strerror(errno), errno);
+        abort();
+    }
+
+    unlink(path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1
+        || listen(fd, 1) == -1) {
+        fprintf(stderr, "sim_dtm: failed to listen on %s: %s (%d)\n", path,
+                strerror(errno), errno);
+        abort();
+    }
+
+    // The client is in charge of the simulation from here on, so we can just
+    // wait for it.
+    fprintf(stderr, "DMI driver listening on unix socket %s\n", path);
+    int client = accept(fd, NULL, NULL);
+    if (client == -1) {
+        fprintf(stderr, "sim_dtm: failed to accept on %s: %s (%d)\n", path,
+                strerror(errno), errno);
+        abort();
+    }
+    close(fd);
+    fprintf(stderr, "DMI driver accepted client\n");
+
+    return fdopen(client, "r+");
+}
+
+int dmi_script_open(struct dmi_source *src)
+{
+    const char *path = getenv("DMI_SCRIPT");
+    struct dmi_script *s;
+
+    if (!path)
+        return 0;
+
+    s = calloc(1, sizeof(*s));
+    if (!s) {
+        fprintf(stderr, "sim_dtm: failed to allocate script state\n");
+        abort();
+    }
+
+    if (!strncmp(path, "unix:", 5)) {
+        s->in  = dmi_script_accept(path + 5);
+        s->out = s->in;
+    } else {
+        s->in = fopen(path, "r");
+    }
+    if (!s->in) {
+        fprintf(stderr, "sim_dtm: failed to open %s: %s (%d)\n", path,
+                strerror(errno), errno);
+        abort();
+    }
+
+    src->next = dmi_script_next;
+    src->done = dmi_script_done;
+    src->quit = dmi_script_quit;
+    src->ctx  = s;
+    return 1;
+}
+
+static void sim_dtm_init()
+{
+    const char *verbose = getenv("JTAG_VERBOSE");
+
+    dtm.init = 1;
+    if (verbose)
+        dtm.verbose = strtol(verbose, NULL, 0);
+    if (dmi_gdb_open(&dtm.src))
+        return;
+    if (dmi_script_open(&dtm.src))
+        return;
+
+    fprintf(stderr,
+            "sim_dtm: no DMI source configured, set GDB_PORT or DMI_SCRIPT\n");
+    abort();
+}
+
+int debug_tick(unsigned char *debug_req_valid, unsigned char debug_req_ready,
+               int *debug_req_bits_addr, int *debug_req_bits_op,
+               int *debug_req_bits_data, unsigned char debug_resp_valid,
+               unsigned char *debug_resp_ready, int debug_resp_bits_resp,
+               int debug_resp_bits_data)
+{
+    if (!dtm.init)
+        sim_dtm_init();
+
+    // the inputs are what the debug module saw together with the outputs of
+    // our previous call
+    if (dtm.req_valid && debug_req_ready) {
+        dtm.req_valid = 0;
+        dtm.busy      = 1;
+    }
+
+    if (dtm.busy && debug_resp_valid) {
+        dtm.busy = 0;
+        if (dtm.verbose)
+            fprintf(stderr, "DMI op=%d addr=0x%02x data=0x%08x -> 0x%08x (%d)\n",
+                    dtm.req.op, dtm.req.addr, dtm.req.data,
+                    (uint32_t)debug_resp_bits_data, debug_resp_bits_resp);
+        dtm.src.done(dtm.src.ctx, &dtm.req, debug_resp_bits_data,
+                     debug_resp_bits_resp);
+    }
+
+    if (!dtm.req_valid && !dtm.busy)
+        dtm.req_valid = dtm.src.next(dtm.src.ctx, &dtm.req);
+
+    *debug_req_valid     = dtm.req_valid;
+    *debug_req_bits_addr = dtm.req.addr;
+    *debug_req_bits_op   = dtm.req_valid ? dtm.req.op : DMI_OP_NOP;
+    *debug_req_bits_data = dtm.req.data;
+    *debug_resp_ready    = 1;
+
+    int code = 0;
+    if (!dtm.req_valid && !dtm.busy && dtm.src.quit(dtm.src.ctx, &code))
+        return code << 1 | 1;
+    return 0;
+}
@@ -0,0 +1,64 @@
+// Copyright 2019 ETH Zurich and University of Bologna.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SIM_DTM_H
+#define SIM_DTM_H
+
+#include <stdint.h>
+
+// DMI operations and responses as defined by the debug spec
+#define DMI_OP_NOP   0
+#define DMI_OP_READ  1
+#define DMI_OP_WRITE 2
+
+#define DMI_RESP_SUCCESS 0
+#define DMI_RESP_FAILED  2
+#define DMI_RESP_BUSY    3
+
+// Debug module registers
+#define DM_DATA0        0x04
+#define DM_DMCONTROL    0x10
+#define DM_DMSTATUS     0x11
+#define DM_ABSTRACTCS   0x16
+#define DM_COMMAND      0x17
+#define DM_PROGBUF0     0x20
+#define DM_SBCS         0x38
+#define DM_SBADDRESS0   0x39
+#define DM_SBDATA0      0x3c
+
+struct dmi_txn {
+    uint8_t op;
+    uint8_t addr;
+    uint32_t data;
+};
+
+// A source of DMI transactions. The driver asks for the next transaction once
+// the previous one has completed and hands every response back through done.
+struct dmi_source {
+    // Fill in txn and return 1 if there is something to do, 0 if the bus
+    // should stay idle this tick.
+    int (*next)(void *ctx, struct dmi_txn *txn);
+    // Called with the response to txn.
+    void (*done)(void *ctx, const struct dmi_txn *txn, uint32_t data, int resp);
+    // Non-zero once the source wants the simulation to end, with the exit code
+    // in *code.
+    int (*quit)(void *ctx, int *code);
+    void *ctx;
+};
+
+// Sources that can drive the DMI, see sim_dtm.c and sim_gdb.c
+int dmi_script_open(struct dmi_source *src);
+int dmi_gdb_open(struct dmi_source *src);
+
+#endif
@@ -0,0 +1,886 @@
+// Copyright 2019 ETH Zurich and University of Bologna.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// GDB remote serial protocol stub for the native DMI driver. GDB connects
+// straight to the simulation (GDB_PORT environment variable) and every packet
+// is translated into a short program of DMI accesses: registers go through
+// abstract commands, memory through system bus access. This skips OpenOCD,
+// the bitbang socket and the JTAG TAP, which makes register reads and program
+// loads orders of magnitude faster than the remote_bitbang path.
+//
+// Supported are ?, g, G, p, P, m, M, c, s, Z0/z0 (software breakpoints),
+// D, k and ^C. Everything else gets an empty reply.
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "sim_dtm.h"
+
+// dmcontrol, dmstatus, abstractcs and sbcs fields
+#define DMCONTROL_HALTREQ   (1u << 31)
+#define DMCONTROL_RESUMEREQ (1u << 30)
+#define DMCONTROL_DMACTIVE  (1u << 0)
+
+#define DMSTATUS_ALLRESUMEACK (1u << 17)
+#define DMSTATUS_ALLHALTED    (1u << 9)
+
+#define ABSTRACTCS_BUSY   (1u << 12)
+#define ABSTRACTCS_CMDERR (7u << 8)
+
+#define SBCS_SBBUSYERROR     (1u << 22)
+#define SBCS_SBBUSY          (1u << 21)
+#define SBCS_SBREADONADDR    (1u << 20)
+#define SBCS_SBACCESS(x)     ((x) << 17)
+#define SBCS_SBAUTOINCREMENT (1u << 16)
+#define SBCS_SBREADONDATA    (1u << 15)
+#define SBCS_SBERROR         (7u << 12)
+
+// access register abstract command
+#define AC_AARSIZE_32 (2u << 20)
+#define AC_TRANSFER   (1u << 17)
+#define AC_WRITE      (1u << 16)
+
+#define REG_GPR0 0x1000
+#define CSR_DCSR 0x7b0
+#define CSR_DPC  0x7b1
+
+#define DCSR_EBREAKM (1u << 15)
+#define DCSR_STEP    (1u << 2)
+
+// gdb register numbers
+#define GDB_REG_PC      32
+#define GDB_REG_FPR0    33
+#define GDB_REG_CSR0    65
+#define GDB_NUM_REGS    33
+
+#define PACKET_SIZE 0x800
+#define MAX_STEPS   4096
+#define MAX_RESULTS 1024
+#define MAX_BREAKPOINTS 64
+
+// ticks between two looks at the socket or dmstatus while there is nothing
+// else to do
+#define IDLE_TICKS 64
+
+// reads of a register we poll before giving up, so a hung core gets an error
+// to gdb instead of hanging the stub
+#define MAX_POLLS 10000
+
+enum step_kind { STEP_WRITE, STEP_READ, STEP_POLL };
+
+// One DMI access of a program. Polls repeat the read until
+// (data & mask) == val and fail the program if any bit of err is set.
+struct step {
+    enum step_kind kind;
+    uint8_t addr;
+    uint32_t data;
+    uint32_t mask, val, err;
+};
+
+// What to do once the current program has finished
+enum finish {
+    FINISH_NONE,
+    FINISH_ATTACH,
+    FINISH_ATTACH_EBREAKM,
+    FINISH_REPLY_OK,
+    FINISH_READ_REGS,
+    FINISH_READ_REG,
+    FINISH_READ_MEM,
+    FINISH_RESUME,
+    FINISH_STEP,
+    FINISH_STEP_DONE,
+    FINISH_STATUS,
+    FINISH_HALT,
+    FINISH_BREAK_SAVE,
+    FINISH_DETACH,
+};
+
+struct breakpoint {
+    uint32_t addr;
+    int len;
+    uint8_t orig[4];
+};
+
+struct gdb {
+    int fd;
+    int running;
+    int quit;
+    long idle;
+    int verbose; // JTAG_VERBOSE, like the remote bitbang server
+
+    // the current program
+    struct step prog[MAX_STEPS];
+    int nprog, pc;
+    int polls;
+    uint32_t res[MAX_RESULTS];
+    int nres;
+    int failed;
+    enum finish finish;
+    // arguments of the packet the program belongs to
+    uint32_t addr, len;
+
+    struct breakpoint bp[MAX_BREAKPOINTS];
+    int nbp;
+
+    char in[2 * PACKET_SIZE];
+    int in_len;
+    char out[2 * PACKET_SIZE + 4];
+};
+
+static const char hex[] = "0123456789abcdef";
+
+static int unhex(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+static void gdb_write(struct gdb *g, const char *buf, size_t len)
+{
+    while (len) {
+        ssize_t n = write(g->fd, buf, len);
+        if (n == -1) {
+            if (errno == EAGAIN || errno == EINTR)
+                continue;
+            fprintf(stderr, "sim_gdb: failed to write to socket: %s (%d)\n",
+                    strerror(errno), errno);
+            abort();
+        }
+        buf += n;
+        len -= n;
+    }
+}
+
+static int gdb_checksum(const char *data)
+{
+    uint8_t sum = 0;
+
+    while (*data)
+        sum += *data++;
+    return sum;
+}
+
+static void gdb_reply(struct gdb *g, const char *data)
+{
+    size_t len = strlen(data);
+    uint8_t sum = 0;
+
+    if (g->verbose)
+        fprintf(stderr, "sim_gdb: -> %s\n", data);
+
+    g->out[0] = '$';
+    for (size_t i = 0; i < len; i++) {
+        g->out[i + 1] = data[i];
+        sum += data[i];
+    }
+    g->out[len + 1] = '#';
+    g->out[len + 2] = hex[sum >> 4];
+    g->out[len + 3] = hex[sum & 0xf];
+    gdb_write(g, g->out, len + 4);
+}
+
+// register and memory contents go over the wire in target (little endian)
+// byte order
+static char *put_word(char *p, uint32_t val)
+{
+    for (int i = 0; i < 4; i++, val >>= 8) {
+        *p++ = hex[(val >> 4) & 0xf];
+        *p++ = hex[val & 0xf];
+    }
+    return p;
+}
+
+static int get_word(const char *p, uint32_t *val)
+{
+    *val = 0;
+    for (int i = 0; i < 4; i++) {
+        int hi = unhex(p[2 * i]), lo = unhex(p[2 * i + 1]);
+        if (hi < 0 || lo < 0)
+            return 0;
+        *val |= (uint32_t)(hi << 4 | lo) << (8 * i);
+    }
+    return 1;
+}
+
+// Program construction
+
+static void prog_start(struct gdb *g, enum finish finish)
+{
+    g->nprog  = 0;
+    g->pc     = 0;
+    g->polls  = 0;
+    g->nres   = 0;
+    g->failed = 0;
+    g->finish = finish;
+}
+
+static void prog_add(struct gdb *g, enum step_kind kind, uint8_t addr,
+                     uint32_t data, uint32_t mask, uint32_t val, uint32_t err)
+{
+    if (g->nprog == MAX_STEPS) {
+        fprintf(stderr, "sim_gdb: program too long\n");
+        abort();
+    }
+    g->prog[g->nprog++] = (struct step){kind, addr, data, mask, val, err};
+}
+
+static void prog_write(struct gdb *g, uint8_t addr, uint32_t data)
+{
+    prog_add(g, STEP_WRITE, addr, data, 0, 0, 0);
+}
+
+static void prog_read(struct gdb *g, uint8_t addr)
+{
+    prog_add(g, STEP_READ, addr, 0, 0, 0, 0);
+}
+
+static void prog_poll(struct gdb *g, uint8_t addr, uint32_t mask, uint32_t val,
+                      uint32_t err)
+{
+    prog_add(g, STEP_POLL, addr, 0, mask, val, err);
+}
+
+static void prog_abstract_wait(struct gdb *g)
+{
+    prog_poll(g, DM_ABSTRACTCS, ABSTRACTCS_BUSY, 0, ABSTRACTCS_CMDERR);
+}
+
+static void prog_read_reg(struct gdb *g, uint16_t regno)
+{
+    prog_write(g, DM_COMMAND, AC_AARSIZE_32 | AC_TRANSFER | regno);
+    prog_abstract_wait(g);
+    prog_read(g, DM_DATA0);
+}
+
+static void prog_write_reg(struct gdb *g, uint16_t regno, uint32_t val)
+{
+    prog_write(g, DM_DATA0, val);
+    prog_write(g, DM_COMMAND, AC_AARSIZE_32 | AC_TRANSFER | AC_WRITE | regno);
+    prog_abstract_wait(g);
+}
+
+static void prog_sb_wait(struct gdb *g)
+{
+    prog_poll(g, DM_SBCS, SBCS_SBBUSY, 0, SBCS_SBERROR | SBCS_SBBUSYERROR);
+}
+
+// Read the words covering [addr, addr + len) into the results
+static void prog_read_mem(struct gdb *g, uint32_t addr, uint32_t len)
+{
+    uint32_t start = addr & ~3u;
+    uint32_t words = (addr + len - start + 3) / 4;
+
+    prog_write(g, DM_SBCS,
+               SBCS_SBREADONADDR | SBCS_SBACCESS(2) | SBCS_SBAUTOINCREMENT
+                   | SBCS_SBREADONDATA);
+    prog_write(g, DM_SBADDRESS0, start);
+    for (uint32_t i = 0; i < words - 1; i++) {
+        prog_sb_wait(g);
+        prog_read(g, DM_SBDATA0);
+    }
+    // reading the last word must not start a bus read past the range
+    prog_sb_wait(g);
+    prog_write(g, DM_SBCS, SBCS_SBACCESS(2));
+    prog_read(g, DM_SBDATA0);
+}
+
+// Write len bytes, using word accesses where possible
+static void prog_write_mem(struct gdb *g, uint32_t addr, const uint8_t *data,
+                           uint32_t len)
+{
+    int size = -1;
+
+    while (len) {
+        int s = (addr & 3) == 0 && len >= 4 ? 2 : 0;
+        uint32_t val = 0;
+
+        if (s != size) {
+            prog_write(g, DM_SBCS, SBCS_SBACCESS(s));
+            size = s;
+        }
+        for (int i = 0; i < (1 << s); i++)
+            val |= (uint32_t)data[i] << (8 * i);
+
+        prog_write(g, DM_SBADDRESS0, addr);
+        prog_write(g, DM_SBDATA0, val);
+        prog_sb_wait(g);
+
+        addr += 1 << s;
+        data += 1 << s;
+        len -= 1 << s;
+    }
+}
+
+static void prog_halt(struct gdb *g)
+{
+    prog_write(g, DM_DMCONTROL, DMCONTROL_HALTREQ | DMCONTROL_DMACTIVE);
+    prog_poll(g, DM_DMSTATUS, DMSTATUS_ALLHALTED, DMSTATUS_ALLHALTED, 0);
+    prog_write(g, DM_DMCONTROL, DMCONTROL_DMACTIVE);
+}
+
+static void prog_resume(struct gdb *g)
+{
+    prog_write(g, DM_DMCONTROL, DMCONTROL_RESUMEREQ | DMCONTROL_DMACTIVE);
+    prog_poll(g, DM_DMSTATUS, DMSTATUS_ALLRESUMEACK, DMSTATUS_ALLRESUMEACK, 0);
+    prog_write(g, DM_DMCONTROL, DMCONTROL_DMACTIVE);
+}
+
+// Packet handling
+
+static void gdb_read_regs_reply(struct gdb *g)
+{
+    char buf[GDB_NUM_REGS * 8 + 1];
+    char *p = buf;
+
+    for (int i = 0; i < GDB_NUM_REGS; i++)
+        p = put_word(p, g->res[i]);
+    *p = '\0';
+    gdb_reply(g, buf);
+}
+
+static void gdb_read_mem_reply(struct gdb *g)
+{
+    char buf[2 * PACKET_SIZE + 1];
+    char *p        = buf;
+    uint32_t start = g->addr & ~3u;
+
+    for (uint32_t a = g->addr; a < g->addr + g->len; a++) {
+        uint8_t b = g->res[(a - start) / 4] >> (8 * ((a - start) % 4));
+        *p++      = hex[b >> 4];
+        *p++      = hex[b & 0xf];
+    }
+    *p = '\0';
+    gdb_reply(g, buf);
+}
+
+static struct breakpoint *gdb_find_bp(struct gdb *g, uint32_t addr)
+{
+    for (int i = 0; i < g->nbp; i++)
+        if (g->bp[i].addr == addr)
+            return &g->bp[i];
+    return NULL;
+}
+
+static void gdb_handle_packet(struct gdb *g, char *pkt)
+{
+    unsigned long a, b;
+    char *p;
+
+    if (g->verbose)
+        fprintf(stderr, "sim_gdb: <- %s\n", pkt);
+
+    switch (pkt[0]) {
+    case '?':
+        gdb_reply(g, "S05");
+        return;
+
+    case 'g':
+        prog_start(g, FINISH_READ_REGS);
+        for (int i = 0; i < 32; i++)
+            prog_read_reg(g, REG_GPR0 + i);
+        prog_read_reg(g, CSR_DPC);
+        return;
+
+    case 'G':
+        if (strlen(pkt + 1) < GDB_NUM_REGS * 8)
+            break;
+        prog_start(g, FINISH_REPLY_OK);
+        for (int i = 1; i < GDB_NUM_REGS; i++) {
+            uint32_t val;
+            if (!get_word(pkt + 1 + 8 * i, &val))
+                goto error;
+            prog_write_reg(g, i == GDB_REG_PC ? CSR_DPC : REG_GPR0 + i, val);
+        }
+        return;
+
+    case 'p':
+        a = strtoul(pkt + 1, NULL, 16);
+        if (a >= GDB_REG_FPR0 && a < GDB_REG_CSR0) {
+            gdb_reply(g, "xxxxxxxx"); // no fpu
+            return;
+        }
+        prog_start(g, FINISH_READ_REG);
+        prog_read_reg(g, a < 32 ? REG_GPR0 + a
+                                : a == GDB_REG_PC ? CSR_DPC
+                                                  : a - GDB_REG_CSR0);
+        return;
+
+    case 'P': {
+        uint32_t val;
+        a = strtoul(pkt + 1, &p, 16);
+        if (*p != '=' || !get_word(p + 1, &val))
+            break;
+        if (a >= GDB_REG_FPR0 && a < GDB_REG_CSR0)
+            goto error;
+        prog_start(g, FINISH_REPLY_OK);
+        prog_write_reg(g, a < 32 ? REG_GPR0 + a
+                                 : a == GDB_REG_PC ? CSR_DPC
+                                                   : a - GDB_REG_CSR0,
+                       val);
+        return;
+    }
+
+    case 'm':
+        a = strtoul(pkt + 1, &p, 16);
+        if (*p != ',')
+            break;
+        b = strtoul(p + 1, NULL, 16);
+        if (b == 0) {
+            gdb_reply(g, "");
+            return;
+        }
+        if (b > PACKET_SIZE / 2)
+            b = PACKET_SIZE / 2;
+        g->addr = a;
+        g->len  = b;
+        prog_start(g, FINISH_READ_MEM);
+        prog_read_mem(g, a, b);
+        return;
+
+    case 'M': {
+        uint8_t data[PACKET_SIZE];
+        a = strtoul(pkt + 1, &p, 16);
+        if (*p != ',')
+            break;
+        b = strtoul(p + 1, &p, 16);
+        if (*p != ':' || b > sizeof(data) || strlen(p + 1) < 2 * b)
+            break;
+        for (unsigned long i = 0; i < b; i++) {
+            int hi = unhex(p[1 + 2 * i]), lo = unhex(p[2 + 2 * i]);
+            if (hi < 0 || lo < 0)
+                goto error;
+            data[i] = hi << 4 | lo;
+        }
+        prog_start(g, FINISH_REPLY_OK);
+        prog_write_mem(g, a, data, b);
+        return;
+    }
+
+    case 'c':
+        prog_start(g, FINISH_RESUME);
+        if (pkt[1])
+            prog_write_reg(g, CSR_DPC, strtoul(pkt + 1, NULL, 16));
+        prog_resume(g);
+        return;
+
+    case 's':
+        prog_start(g, FINISH_STEP);
+        if (pkt[1])
+            prog_write_reg(g, CSR_DPC, strtoul(pkt + 1, NULL, 16));
+        prog_read_reg(g, CSR_DCSR);
+        return;
+
+    case 'Z':
+    case 'z':
+        if (pkt[1] != '0')
+            break; // only software breakpoints
+        a = strtoul(pkt + 3, &p, 16);
+        b = *p == ',' ? strtoul(p + 1, NULL, 16) : 4;
+        if (b != 2 && b != 4)
+            goto error;
+        if (pkt[0] == 'Z') {
+            if (gdb_find_bp(g, a)) {
+                gdb_reply(g, "OK");
+                return;
+            }
+            if (g->nbp == MAX_BREAKPOINTS)
+                goto error;
+            g->addr = a;
+            g->len  = b;
+            prog_start(g, FINISH_BREAK_SAVE);
+            prog_read_mem(g, a, b);
+        } else {
+            struct breakpoint *bp = gdb_find_bp(g, a);
+            if (!bp) {
+                gdb_reply(g, "OK");
+                return;
+            }
+            prog_start(g, FINISH_REPLY_OK);
+            prog_write_mem(g, bp->addr, bp->orig, bp->len);
+            *bp = g->bp[--g->nbp];
+        }
+        return;
+
+    case 'D':
+        prog_start(g, FINISH_DETACH);
+        prog_resume(g);
+        return;
+
+    case 'k':
+        g->quit = 1;
+        return;
+
+    case 'H':
+        gdb_reply(g, "OK");
+        return;
+
+    case 'q':
+        if (!strncmp(pkt, "qSupported", 10)) {
+            char buf[32];
+            snprintf(buf, sizeof(buf), "PacketSize=%x", PACKET_SIZE);
+            gdb_reply(g, buf);
+            return;
+        }
+        if (!strcmp(pkt, "qAttached")) {
+            gdb_reply(g, "1");
+            return;
+        }
+        break;
+    }
+
+    // unsupported
+    gdb_reply(g, "");
+    return;
+
+error:
+    gdb_reply(g, "E01");
+}
+
+// Called once a program ran to completion (or failed)
+static void gdb_finish(struct gdb *g)
+{
+    enum finish finish = g->finish;
+
+    g->finish = FINISH_NONE;
+    g->nprog  = 0;
+    g->pc     = 0;
+
+    if (g->failed) {
+        // clear sticky errors so the next command has a chance
+        prog_start(g, FINISH_NONE);
+        prog_write(g, DM_ABSTRACTCS, ABSTRACTCS_CMDERR);
+        prog_write(g, DM_SBCS, SBCS_SBERROR | SBCS_SBBUSYERROR);
+        if (finish == FINISH_ATTACH || finish == FINISH_ATTACH_EBREAKM)
+            fprintf(stderr, "sim_gdb: failed to halt the core\n");
+        else if (finish == FINISH_STATUS)
+            g->running = 1;
+        else
+            gdb_reply(g, "E01");
+        return;
+    }
+
+    switch (finish) {
+    case FINISH_NONE:
+        break;
+    case FINISH_ATTACH:
+        // make ebreak enter debug mode so software breakpoints work
+        prog_start(g, FINISH_ATTACH_EBREAKM);
+        prog_write_reg(g, CSR_DCSR, g->res[0] | DCSR_EBREAKM);
+        break;
+    case FINISH_ATTACH_EBREAKM:
+        fprintf(stderr, "sim_gdb: core halted, ready for gdb\n");
+        break;
+    case FINISH_REPLY_OK:
+        gdb_reply(g, "OK");
+        break;
+    case FINISH_READ_REGS:
+        gdb_read_regs_reply(g);
+        break;
+    case FINISH_READ_REG: {
+        char buf[9];
+        *put_word(buf, g->res[0]) = '\0';
+        gdb_reply(g, buf);
+        break;
+    }
+    case FINISH_READ_MEM:
+        gdb_read_mem_reply(g);
+        break;
+    case FINISH_RESUME:
+        g->running = 1;
+        g->idle    = 0;
+        break;
+    case FINISH_STEP:
+        // res[0] is dcsr
+        prog_start(g, FINISH_STEP_DONE);
+        prog_write_reg(g, CSR_DCSR, g->res[0] | DCSR_STEP);
+        prog_resume(g);
+        prog_poll(g, DM_DMSTATUS, DMSTATUS_ALLHALTED, DMSTATUS_ALLHALTED, 0);
+        prog_write_reg(g, CSR_DCSR, g->res[0] & ~DCSR_STEP);
+        break;
+    case FINISH_STEP_DONE:
+        gdb_reply(g, "S05");
+        break;
+    case FINISH_STATUS:
+        if (g->res[0] & DMSTATUS_ALLHALTED)
+            gdb_reply(g, "S05");
+        else
+            g->running = 1;
+        break;
+    case FINISH_HALT:
+        gdb_reply(g, "S02");
+        break;
+    case FINISH_BREAK_SAVE: {
+        struct breakpoint *bp = &g->bp[g->nbp++];
+        uint32_t start        = g->addr & ~3u;
+        bp->addr              = g->addr;
+        bp->len               = g->len;
+        for (int i = 0; i < bp->len; i++) {
+            uint32_t a = g->addr + i - start;
+            bp->orig[i] = g->res[a / 4] >> (8 * (a % 4));
+        }
+        // c.ebreak or ebreak
+        uint8_t ebreak[4] = {0x73, 0x00, 0x10, 0x00};
+        uint8_t c_ebreak[2] = {0x02, 0x90};
+        prog_start(g, FINISH_REPLY_OK);
+        prog_write_mem(g, bp->addr, bp->len == 2 ? c_ebreak : ebreak, bp->len);
+        break;
+    }
+    case FINISH_DETACH:
+        gdb_reply(g, "OK");
+        close(g->fd);
+        g->fd   = -1;
+        g->quit = 1;
+        break;
+    }
+}
+
+// Pull whatever gdb sent us and handle complete packets. Only called while no
+// program is running.
+static void gdb_poll_socket(struct gdb *g)
+{
+    if (g->fd < 0)
+        return;
+
+    ssize_t n = read(g->fd, g->in + g->in_len, sizeof(g->in) - g->in_len);
+    if (n == 0) {
+        fprintf(stderr, "sim_gdb: gdb disconnected\n");
+        close(g->fd);
+        g->fd   = -1;
+        g->quit = 1;
+        return;
+    }
+    if (n == -1) {
+        if (errno != EAGAIN && errno != EINTR) {
+            fprintf(stderr, "sim_gdb: failed to read from socket: %s (%d)\n",
+                    strerror(errno), errno);
+            abort();
+        }
+        n = 0;
+    }
+    g->in_len += n;
+
+    while (g->in_len && !g->nprog) {
+        char *start = g->in;
+        int consumed;
+
+        if (*start == '\x03') {
+            // interrupt, only meaningful while the core runs
+            consumed = 1;
+            if (g->running) {
+                g->running = 0;
+                prog_start(g, FINISH_HALT);
+                prog_halt(g);
+            }
+        } else if (*start == '$') {
+            char *end = memchr(start, '#', g->in_len);
+            if (!end || end + 3 > g->in + g->in_len)
+                break; // incomplete
+            if (g->running) {
+                // gdb shouldn't talk to a running target, but be lenient and
+                // leave the packet for after the halt
+                g->running = 0;
+                prog_start(g, FINISH_NONE);
+                prog_halt(g);
+                break;
+            }
+            int hi = unhex(end[1]), lo = unhex(end[2]);
+            *end     = '\0';
+            consumed = end + 3 - g->in;
+            if (hi < 0 || lo < 0 || gdb_checksum(start + 1) != (hi << 4 | lo)) {
+                // ask for the packet again
+                gdb_write(g, "-", 1);
+            } else {
+                gdb_write(g, "+", 1);
+                gdb_handle_packet(g, start + 1);
+            }
+        } else {
+            // acks and line noise
+            consumed = 1;
+        }
+
+        memmove(g->in, g->in + consumed, g->in_len - consumed);
+        g->in_len -= consumed;
+    }
+
+    if (g->in_len == sizeof(g->in)) {
+        fprintf(stderr, "sim_gdb: packet too long, dropping it\n");
+        g->in_len = 0;
+    }
+}
+
+static int gdb_next(void *ctx, struct dmi_txn *txn)
+{
+    struct gdb *g = ctx;
+
+    while (1) {
+        if (g->pc < g->nprog) {
+            struct step *s = &g->prog[g->pc];
+            txn->op        = s->kind == STEP_WRITE ? DMI_OP_WRITE : DMI_OP_READ;
+            txn->addr      = s->addr;
+            txn->data      = s->data;
+            return 1;
+        }
+
+        if (g->nprog) {
+            gdb_finish(g);
+            continue;
+        }
+
+        if (g->quit || g->idle++ % IDLE_TICKS)
+            return 0;
+
+        gdb_poll_socket(g);
+        if (g->nprog)
+            continue;
+
+        if (!g->running)
+            return 0;
+
+        // see whether the core hit a breakpoint
+        g->running = 0;
+        prog_start(g, FINISH_STATUS);
+        prog_read(g, DM_DMSTATUS);
+    }
+}
+
+static void gdb_done(void *ctx, const struct dmi_txn *txn, uint32_t data,
+                     int resp)
+{
+    struct gdb *g  = ctx;
+    struct step *s = &g->prog[g->pc];
+
+    (void)txn;
+
+    if (resp != DMI_RESP_SUCCESS) {
+        g->failed = 1;
+        g->pc     = g->nprog;
+        return;
+    }
+
+    switch (s->kind) {
+    case STEP_WRITE:
+        g->pc++;
+        break;
+    case STEP_READ:
+        if (g->nres < MAX_RESULTS)
+            g->res[g->nres++] = data;
+        g->pc++;
+        break;
+    case STEP_POLL:
+        if (data & s->err) {
+            g->failed = 1;
+            g->pc     = g->nprog;
+        } else if ((data & s->mask) == s->val) {
+            g->polls = 0;
+            g->pc++;
+        } else if (++g->polls == MAX_POLLS) {
+            fprintf(stderr, "sim_gdb: debug module register 0x%02x did not "
+                    "get ready, giving up\n", s->addr);
+            g->polls  = 0;
+            g->failed = 1;
+            g->pc     = g->nprog;
+        }
+        break;
+    }
+}
+
+static int gdb_quit(void *ctx, int *code)
+{
+    struct gdb *g = ctx;
+
+    *code = 0;
+    return g->quit && g->pc == g->nprog;
+}
+
+int dmi_gdb_open(struct dmi_source *src)
+{
+    const char *port = getenv("GDB_PORT");
+    struct gdb *g;
+
+    if (!port)
+        return 0;
+
+    g = calloc(1, sizeof(*g));
+    if (!g) {
+        fprintf(stderr, "sim_gdb: failed to allocate state\n");
+        abort();
+    }
+
+    const char *verbose = getenv("JTAG_VERBOSE");
+    if (verbose)
+        g->verbose = strtol(verbose, NULL, 0);
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd == -1) {
+        fprintf(stderr, "sim_gdb: failed to make socket: %s (%d)\n",
+                strerror(errno), errno);
+        abort();
+    }
+
+    int reuseaddr = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuseaddr, sizeof(reuseaddr));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port        = htons(strtol(port, NULL, 0));
+
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1
+        || listen(fd, 1) == -1) {
+        fprintf(stderr, "sim_gdb: failed to listen on port %s: %s (%d)\n",
+                port, strerror(errno), errno);
+        abort();
+    }
+
+    // gdb is in charge of the simulation, there is nothing to do until it
+    // shows up
+    fprintf(stderr, "GDB server listening on port %s\n", port);
+    g->fd = accept(fd, NULL, NULL);
+    if (g->fd == -1) {
+        fprintf(stderr, "sim_gdb: failed to accept: %s (%d)\n",
+                strerror(errno), errno);
+        abort();
+    }
+    close(fd);
+
+    int nodelay = 1;
+    setsockopt(g->fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+    fcntl(g->fd, F_SETFL, O_NONBLOCK);
+    fprintf(stderr, "GDB connected\n");
+
+    // activate the debug module, halt the core and remember dcsr
+    prog_start(g, FINISH_ATTACH);
+    prog_write(g, DM_DMCONTROL, DMCONTROL_DMACTIVE);
+    prog_halt(g);
+    prog_read_reg(g, CSR_DCSR);
+
+    src->next = gdb_next;
+    src->done = gdb_done;
+    src->quit = gdb_quit;
+    src->ctx  = g;
+    return 1;
+}
@@ -2,28 +2,75 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 #include "remote_bitbang.h"
 
-int init = 0;
+// All servers of this process, keyed by the port they were created for. Each
+// SimJTAG instance must therefore use a distinct PORT.
+//
+// If JTAG_UNIX_SOCKET is set we listen on a unix domain socket at that path
+// instead of the TCP port. A %d in the path is replaced by the port, which
+// keeps the sockets of several instances apart.
+struct jtag_server {
+    int port;
+    struct rbs *rbs;
+    struct jtag_server *next;
+};
+
+static struct jtag_server *servers = NULL;
+
+static struct rbs *jtag_server(int port)
+{
+    struct jtag_server *server;
+
+    for (server = servers; server; server = server->next)
+        if (server->port == port)
+            return server->rbs;
+
+    if (port < 0 || port > UINT16_MAX) {
+        fprintf(stderr, "Port number of out range: %d\n", port);
+        abort();
+    }
+
+    server = malloc(sizeof(*server));
+    if (!server) {
+        fprintf(stderr, "failed to allocate jtag server\n");
+        abort();
+    }
+    server->port = port;
+
+    const char *path = getenv("JTAG_UNIX_SOCKET");
+    if (path) {
+        char buf[sizeof(server->rbs->path)];
+        const char *p = strstr(path, "%d");
+        if (p)
+            snprintf(buf, sizeof(buf), "%.*s%d%s", (int)(p - path), path, port,
+                     p + 2);
+        else
+            snprintf(buf, sizeof(buf), "%s", path);
+        server->rbs = rbs_init_unix(buf);
+    } else {
+        server->rbs = rbs_init(port);
+    }
+    server->next = servers;
+    servers      = server;
+    return server->rbs;
+}
 
 int jtag_tick(int port, unsigned char *jtag_TCK, unsigned char *jtag_TMS,
               unsigned char *jtag_TDI, unsigned char *jtag_TRSTn,
               unsigned char jtag_TDO)
 
 {
-    if (!init) {
-	if (port < 0 || port > UINT16_MAX)
-	    fprintf(stderr, "Port number of out range: %d\n", port);
-        init = rbs_init(port);
-    }
+    struct rbs *rbs = jtag_server(port);
 
-    rbs_tick(jtag_TCK, jtag_TMS, jtag_TDI, jtag_TRSTn, jtag_TDO);
-    if (VERBOSE)
+    rbs_tick(rbs, jtag_TCK, jtag_TMS, jtag_TDI, jtag_TRSTn, jtag_TDO);
+    if (rbs->verbose > 1)
         fprintf(
             stderr,
-            "Tick with: TCK=%hhd TMS=%hhd TDI=%hhd TRSTn=%hhd --> TDO=%hhd\n",
-            *jtag_TCK, *jtag_TMS, *jtag_TDI, *jtag_TRSTn, jtag_TDO);
+            "Tick on port %d with: TCK=%hhd TMS=%hhd TDI=%hhd TRSTn=%hhd --> TDO=%hhd\n",
+            port, *jtag_TCK, *jtag_TMS, *jtag_TDI, *jtag_TRSTn, jtag_TDO);
 
-    return rbs_done() ? (rbs_exit_code() << 1 | 1) : 0;
+    return rbs_done(rbs) ? (rbs_exit_code(rbs) << 1 | 1) : 0;
 }
@@ -17,7 +17,8 @@ module tb_test_env
       parameter BOOT_ADDR = 'h80,
       parameter PULP_SECURE = 1,
       parameter JTAG_BOOT = 1,
-      parameter OPENOCD_PORT = 0)
+      parameter OPENOCD_PORT = 0,
+      parameter SIM_DTM = 0)
     (input logic clk_i,
      input logic  rst_ni,
 
@@ -62,6 +63,14 @@ module tb_test_env
     logic [31:0]            sim_jtag_exit;
     logic                   sim_jtag_enable;
 
+    // native dmi driver signals
+    logic                   sim_dtm_req_valid;
+    logic [6:0]             sim_dtm_req_addr;
+    logic [1:0]             sim_dtm_req_op;
+    logic [31:0]            sim_dtm_req_data;
+    logic                   sim_dtm_resp_ready;
+    logic [31:0]            sim_dtm_exit;
+
     // signals for debug unit
     logic                        debug_req_ready;
     dm::dmi_resp_t               debug_resp;
@@ -69,6 +78,9 @@ module tb_test_env
     dm::dmi_req_t                jtag_dmi_req;
     logic                        jtag_resp_ready;
     logic                        jtag_resp_valid;
+    logic                        dmi_req_valid;
+    dm::dmi_req_t                dmi_req;
+    logic                        dmi_resp_ready;
     logic [NrHarts-1:0]          dm_debug_req;
     logic                        ndmreset, ndmreset_n;
 
@@ -99,8 +111,8 @@ module tb_test_env
     logic [0:4]                  irq_id_out;
     logic                        irq_sec;
 
-    // make jtag bridge work
-    assign sim_jtag_enable = JTAG_BOOT;
+    // make jtag bridge work, unless the dmi is driven natively
+    assign sim_jtag_enable = JTAG_BOOT && !SIM_DTM;
 
     // interrupts (only timer for now)
     assign irq_sec = '0;
@@ -272,14 +284,30 @@ module tb_test_env
        .master_r_rdata_i  ( sb_rdata          ),
 
        .dmi_rst_ni        ( rst_ni            ),
-       .dmi_req_valid_i   ( jtag_req_valid    ),
+       .dmi_req_valid_i   ( dmi_req_valid     ),
        .dmi_req_ready_o   ( debug_req_ready   ),
-       .dmi_req_i         ( jtag_dmi_req      ),
+       .dmi_req_i         ( dmi_req           ),
        .dmi_resp_valid_o  ( jtag_resp_valid   ),
-       .dmi_resp_ready_i  ( jtag_resp_ready   ),
+       .dmi_resp_ready_i  ( dmi_resp_ready    ),
        .dmi_resp_o        ( debug_resp        )
     );
 
+    // the debug module either listens to the jtag dtm or to the native dmi
+    // driver
+    always_comb begin : dmi_mux
+        if (SIM_DTM) begin
+            dmi_req_valid  = sim_dtm_req_valid;
+            dmi_req.addr   = sim_dtm_req_addr;
+            dmi_req.op     = dm::dtm_op_t'(sim_dtm_req_op);
+            dmi_req.data   = sim_dtm_req_data;
+            dmi_resp_ready = sim_dtm_resp_ready;
+        end else begin
+            dmi_req_valid  = jtag_req_valid;
+            dmi_req        = jtag_dmi_req;
+            dmi_resp_ready = jtag_resp_ready;
+        end
+    end
+
     // grant in the same cycle
     assign dm_gnt = dm_req;
     // valid read/write in the next cycle
@@ -322,4 +350,35 @@ module tb_test_env
             $finish(2); // print stats too
     end
 
+    // dmi requests from dpi, bypassing jtag
+    generate
+    if (SIM_DTM) begin : gen_sim_dtm
+        SimDTM i_sim_dtm (
+            .clk                  ( clk_i                ),
+            .reset                ( ~rst_ni              ),
+            .debug_req_valid      ( sim_dtm_req_valid    ),
+            .debug_req_ready      ( debug_req_ready      ),
+            .debug_req_bits_addr  ( sim_dtm_req_addr     ),
+            .debug_req_bits_op    ( sim_dtm_req_op       ),
+            .debug_req_bits_data  ( sim_dtm_req_data     ),
+            .debug_resp_valid     ( jtag_resp_valid      ),
+            .debug_resp_ready     ( sim_dtm_resp_ready   ),
+            .debug_resp_bits_resp ( debug_resp.resp      ),
+            .debug_resp_bits_data ( debug_resp.data      ),
+            .exit                 ( sim_dtm_exit         ));
+
+        always_comb begin : dtm_exit_handler
+            if (sim_dtm_exit)
+                $finish(2); // print stats too
+        end
+    end else begin : gen_no_sim_dtm
+        assign sim_dtm_req_valid  = 1'b0;
+        assign sim_dtm_req_addr   = '0;
+        assign sim_dtm_req_op     = '0;
+        assign sim_dtm_req_data   = '0;
+        assign sim_dtm_resp_ready = 1'b0;
+        assign sim_dtm_exit       = '0;
+    end
+    endgenerate
+
 endmodule // tb_test_env
@@ -19,7 +19,8 @@ module tb_top
       parameter RAM_ADDR_WIDTH = 22,
       parameter BOOT_ADDR  = 'h1A00_0080,
       parameter JTAG_BOOT  = 1,
-      parameter OPENOCD_PORT = 9999);
+      parameter OPENOCD_PORT = 9999,
+      parameter SIM_DTM = 0);
 
     // comment to record execution trace
     //`define TRACE_EXECUTION
@@ -123,7 +124,8 @@ module tb_top
         .BOOT_ADDR (BOOT_ADDR),
         .PULP_SECURE (1),
         .JTAG_BOOT (JTAG_BOOT),
-        .OPENOCD_PORT (OPENOCD_PORT))
+        .OPENOCD_PORT (OPENOCD_PORT),
+        .SIM_DTM (SIM_DTM))
     tb_test_env_i(
         .clk_i          ( clk            ),
         .rst_ni         ( rst_n          ),
@@ -8,13 +8,16 @@
 // CONDITIONS OF ANY KIND, either express or implied. See the License for the
 // specific language governing permissions and limitations under the License.
 
-// Top level wrapper for a verilator RI5CY testbench
+// Top level wrapper for a verilator RI5CY debug testbench
 // Contributor: Robert Balas <balasr@student.ethz.ch>
 
 module tb_top_verilator
     #(parameter INSTR_RDATA_WIDTH = 32,
       parameter RAM_ADDR_WIDTH = 22,
-      parameter BOOT_ADDR  = 'h80)
+      parameter BOOT_ADDR  = 'h1A00_0080,
+      parameter JTAG_BOOT  = 1,
+      parameter OPENOCD_PORT = 9999,
+      parameter SIM_DTM = 0)
     (input logic clk_i,
      input logic  rst_ni,
      input logic  fetch_enable_i,
@@ -31,39 +34,40 @@ module tb_top_verilator
             if($test$plusargs("verbose"))
                 $display("[TESTBENCH] %t: loading firmware %0s ...",
                          $time, firmware);
-            $readmemh(firmware, riscv_wrapper_i.ram_i.dp_ram_i.mem);
+            $readmemh(firmware, tb_test_env_i.mm_ram_i.dp_ram_i.mem);
 
         end else begin
             $display("No firmware specified");
-            $finish;
         end
      end
 
     // check if we succeded
     always_ff @(posedge clk_i, negedge rst_ni) begin
         if (tests_passed_o) begin
-            $display("ALL TESTS PASSED");
+            $display("Exit Success");
             $finish;
         end
         if (tests_failed_o) begin
-            $display("TEST(S) FAILED!");
+            $display("Exit FAILURE");
             $finish;
         end
     end
 
-    // wrapper for riscv, the memory system and stdout peripheral
-    riscv_wrapper
-        #(.INSTR_RDATA_WIDTH (INSTR_RDATA_WIDTH),
-          .RAM_ADDR_WIDTH (RAM_ADDR_WIDTH),
-          .BOOT_ADDR (BOOT_ADDR),
-          .PULP_SECURE (0)) // need to disable because non-blocking and blocking
-                            // assignment to same variable
-    riscv_wrapper_i
-        (.clk_i          ( clk_i          ),
-         .rst_ni         ( rst_ni         ),
-         .fetch_enable_i ( fetch_enable_i ),
-         .tests_passed_o ( tests_passed_o ),
-         .tests_failed_o ( tests_failed_o ));
+    // wrapper for riscv, the memory system, the debug unit and the jtag bridge
+    tb_test_env #(
+        .INSTR_RDATA_WIDTH (INSTR_RDATA_WIDTH),
+        .RAM_ADDR_WIDTH (RAM_ADDR_WIDTH),
+        .BOOT_ADDR (BOOT_ADDR),
+        .PULP_SECURE (0), // need to disable because non-blocking and blocking
+                          // assignment to same variable
+        .JTAG_BOOT (JTAG_BOOT),
+        .OPENOCD_PORT (OPENOCD_PORT),
+        .SIM_DTM (SIM_DTM))
+    tb_test_env_i(
+        .clk_i          ( clk_i          ),
+        .rst_ni         ( rst_ni         ),
+        .fetch_enable_i ( fetch_enable_i ),
+        .tests_passed_o ( tests_passed_o ),
+        .tests_failed_o ( tests_failed_o ));
 
 endmodule // tb_top_verilator
-
@@ -2,5 +2,5 @@
 
 vlib ./work
 
-vlog -sv               ../../../alu_div.sv  || exit 1
-vlog -sv +incdir+../   ../tb.sv             || exit 1
+vlog -sv               ../../../rtl/riscv_alu_div.sv  || exit 1
+vlog -sv +incdir+../   ../tb.sv                       || exit 1
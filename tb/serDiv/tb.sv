@@ -33,12 +33,20 @@ module tb;
   parameter C_WIDTH           = 32;
   parameter C_LOG_WIDTH       = 6;
 
+  // C_RADIX4 selects the radix-4 divider, C_EARLY_TERM shortens the
+  // operand B shift like riscv_alu does with FAST_INT_DIV. Both can be set
+  // from the command line, e.g. vsim -GC_RADIX4=1 -GC_EARLY_TERM=1 tb
+  parameter C_RADIX4          = 0;
+  parameter C_EARLY_TERM      = 0;
+
   longint                 OpA_T, OpA_tmp;
   longint                 OpB_T, OpB_tmp;
 
   logic [C_WIDTH-1:0]     OpA_DI;
   logic [C_WIDTH-1:0]     OpB_DI;
   logic [C_LOG_WIDTH-1:0] OpBShift_DI;
+  logic [C_WIDTH-1:0]     OpBMut_D;
+  logic [C_LOG_WIDTH-1:0] OpBShiftMut_D;
   logic                   OpBIsZero_SI;
 
   logic                   OpBSign_SI;
@@ -103,6 +111,40 @@ module tb;
   endtask
 
 
+///////////////////////////////////////////////////////////////////////////////
+// early termination
+///////////////////////////////////////////////////////////////////////////////
+
+  // leading zeros, or leading ones of a negative signed operand
+  function automatic int leadBits(logic [C_WIDTH-1:0] Op_D, logic Signed_S);
+    int n = 0;
+    logic Lead_S = Signed_S & Op_D[C_WIDTH-1];
+
+    while (n < C_WIDTH && Op_D[C_WIDTH-1-n] == Lead_S)
+      n++;
+    return n;
+  endfunction
+
+  // only shift B up to just above the most significant bit of A, the same
+  // computation as in riscv_alu
+  function automatic logic [C_LOG_WIDTH-1:0] earlyShift(logic [C_WIDTH-1:0] OpA_D,
+                                                        logic [C_WIDTH-1:0] OpB_D,
+                                                        logic [C_LOG_WIDTH-1:0] Shift_D,
+                                                        logic Signed_S);
+    int early;
+
+    if (C_EARLY_TERM == 0 || OpB_D == 0)
+      return Shift_D;
+
+    early = leadBits(OpB_D, Signed_S) + 1 - leadBits(OpA_D, Signed_S);
+    if (early < 0)
+      return 0;
+    else if (early < Shift_D)
+      return early;
+    else
+      return Shift_D;
+  endfunction
+
 ///////////////////////////////////////////////////////////////////////////////
 // Clock Process
 ///////////////////////////////////////////////////////////////////////////////
@@ -124,8 +166,17 @@ module tb;
 ///////////////////////////////////////////////////////////////////////////////
 
 
+  // the stimuli apply the full shift, with C_EARLY_TERM the divider gets the
+  // shorter one of riscv_alu instead
+  assign OpBShiftMut_D = earlyShift(OpA_DI, OpB_T, OpBShift_DI, OpCode_SI[0]);
+  assign OpBMut_D     = OpB_T << OpBShiftMut_D;
+
   assign OpBIsZero_SI = ~(|OpB_DI);
-  riscv_alu_div #(.C_WIDTH(C_WIDTH), .C_LOG_WIDTH(C_LOG_WIDTH)) i_mut (.*);
+  riscv_alu_div #(.C_WIDTH(C_WIDTH), .C_LOG_WIDTH(C_LOG_WIDTH), .C_RADIX4(C_RADIX4)) i_mut (
+    .OpB_DI      ( OpBMut_D      ),
+    .OpBShift_DI ( OpBShiftMut_D ),
+    .*
+  );
 
 ///////////////////////////////////////////////////////////////////////////////
 // application process